@@ -11,8 +11,12 @@
 #include <zephyr/init.h>
 #include <zephyr/settings/settings.h>
 #include <zephyr/drivers/sensor.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/crc.h>
 
 #include "bme68x_iaq.h"
+#include "bme68x_iaq_output.h"
+#include "bme68x_iaq_state.h"
 
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(bsec, CONFIG_BME68X_IAQ_LOG_LEVEL);
@@ -25,153 +29,485 @@ LOG_MODULE_REGISTER(bsec, CONFIG_BME68X_IAQ_LOG_LEVEL);
 /* Temperature offset due to external heat sources. */
 static const float temp_offset = (CONFIG_BME68X_IAQ_TEMPERATURE_OFFSET / (float)100);
 
-/* Define which sensor values to request.
+/* Sensor values requested at the gas sample rate.
  * The order is not important, but output_ready needs to be updated if different types
  * of sensor values are requested.
  */
-static const bsec_sensor_configuration_t bsec_requested_virtual_sensors[] = {
-	/* Gas Measurements */
-	{
-		.sensor_id   = BSEC_OUTPUT_IAQ,
-		.sample_rate = BSEC_GAS_SAMPLE_RATE,
-	},
-	{
-		.sensor_id   = BSEC_OUTPUT_CO2_EQUIVALENT,
-		.sample_rate = BSEC_GAS_SAMPLE_RATE,
-	},
-	{
-		.sensor_id   = BSEC_OUTPUT_BREATH_VOC_EQUIVALENT,
-		.sample_rate = BSEC_GAS_SAMPLE_RATE,
-	},
-	{
-		.sensor_id   = BSEC_OUTPUT_STABILIZATION_STATUS,
-		.sample_rate = BSEC_GAS_SAMPLE_RATE,
-	},
-	{
-		.sensor_id   = BSEC_OUTPUT_RUN_IN_STATUS,
-		.sample_rate = BSEC_GAS_SAMPLE_RATE,
-	},
+static const uint8_t bsec_gas_outputs[] = {
+	BSEC_OUTPUT_IAQ,
+	BSEC_OUTPUT_CO2_EQUIVALENT,
+	BSEC_OUTPUT_BREATH_VOC_EQUIVALENT,
+	BSEC_OUTPUT_STABILIZATION_STATUS,
+	BSEC_OUTPUT_RUN_IN_STATUS,
+};
 
-	/* Temperature, Pressure, Humidity */
-	{
-		.sensor_id   = BSEC_OUTPUT_SENSOR_HEAT_COMPENSATED_TEMPERATURE,
-		.sample_rate = BSEC_SAMPLE_RATE,
-	},
-	{
-		.sensor_id   = BSEC_OUTPUT_RAW_PRESSURE,
-		.sample_rate = BSEC_SAMPLE_RATE,
-	},
-	{
-		.sensor_id   = BSEC_OUTPUT_SENSOR_HEAT_COMPENSATED_HUMIDITY,
-		.sample_rate = BSEC_SAMPLE_RATE,
-	},
+/* Temperature, Pressure, Humidity, requested at the regular sample rate */
+static const uint8_t bsec_thp_outputs[] = {
+	BSEC_OUTPUT_SENSOR_HEAT_COMPENSATED_TEMPERATURE,
+	BSEC_OUTPUT_RAW_PRESSURE,
+	BSEC_OUTPUT_SENSOR_HEAT_COMPENSATED_HUMIDITY,
 };
 
-static const bsec_sensor_configuration_t quick_init_sensor_config[] = {
-	/* Gas Measurements */
-	{
-		.sensor_id   = BSEC_OUTPUT_IAQ,
-		.sample_rate = BSEC_SAMPLE_RATE_CONT,
-	},
-	{
-		.sensor_id   = BSEC_OUTPUT_CO2_EQUIVALENT,
-		.sample_rate = BSEC_SAMPLE_RATE_CONT,
-	},
-	{
-		.sensor_id   = BSEC_OUTPUT_BREATH_VOC_EQUIVALENT,
-		.sample_rate = BSEC_SAMPLE_RATE_CONT,
-	},
-	{
-		.sensor_id   = BSEC_OUTPUT_STABILIZATION_STATUS,
-		.sample_rate = BSEC_SAMPLE_RATE_CONT,
-	},
-	{
-		.sensor_id   = BSEC_OUTPUT_RUN_IN_STATUS,
-		.sample_rate = BSEC_SAMPLE_RATE_CONT,
-	},
+#define BSEC_N_REQUESTED_OUTPUTS (ARRAY_SIZE(bsec_gas_outputs) + ARRAY_SIZE(bsec_thp_outputs))
 
-	/* Temperature, Pressure, Humidity */
-	{
-		.sensor_id   = BSEC_OUTPUT_SENSOR_HEAT_COMPENSATED_TEMPERATURE,
-		.sample_rate = BSEC_SAMPLE_RATE_CONT,
+/* BSEC sample rates used by each sample mode */
+static const struct {
+	float gas;
+	float thp;
+} bsec_sample_rates[] = {
+	[BME68X_IAQ_SAMPLE_RATE_ULTRA_LOW_POWER] = {
+		.gas = BSEC_SAMPLE_RATE_ULP,
+		.thp = BSEC_SAMPLE_RATE_ULP,
 	},
-	{
-		.sensor_id   = BSEC_OUTPUT_RAW_PRESSURE,
-		.sample_rate = BSEC_SAMPLE_RATE_CONT,
+	[BME68X_IAQ_SAMPLE_RATE_LOW_POWER] = {
+		.gas = BSEC_SAMPLE_RATE_LP,
+		.thp = BSEC_SAMPLE_RATE_LP,
 	},
-	{
-		.sensor_id   = BSEC_OUTPUT_SENSOR_HEAT_COMPENSATED_HUMIDITY,
-		.sample_rate = BSEC_SAMPLE_RATE_CONT,
+	[BME68X_IAQ_SAMPLE_RATE_CONTINUOUS] = {
+		.gas = BSEC_SAMPLE_RATE_CONT,
+		.thp = BSEC_SAMPLE_RATE_CONT,
+	},
+	[BME68X_IAQ_SAMPLE_RATE_QUICK_ULTRA_LOW_POWER] = {
+		.gas = BSEC_SAMPLE_RATE_ULP,
+		.thp = BSEC_SAMPLE_RATE_LP,
 	},
 };
 
+/* Sample mode used until one is selected with SENSOR_ATTR_BME68X_IAQ_SAMPLE_RATE */
+#if CONFIG_BME68X_IAQ_SAMPLE_RATE_ULTRA_LOW_POWER
+#define BSEC_DEFAULT_SAMPLE_RATE BME68X_IAQ_SAMPLE_RATE_ULTRA_LOW_POWER
+#elif CONFIG_BME68X_IAQ_SAMPLE_RATE_CONTINUOUS
+#define BSEC_DEFAULT_SAMPLE_RATE BME68X_IAQ_SAMPLE_RATE_CONTINUOUS
+#elif CONFIG_BME68X_IAQ_SAMPLE_RATE_QUICK_ULTRA_LOW_POWER
+#define BSEC_DEFAULT_SAMPLE_RATE BME68X_IAQ_SAMPLE_RATE_QUICK_ULTRA_LOW_POWER
+#else
+#define BSEC_DEFAULT_SAMPLE_RATE BME68X_IAQ_SAMPLE_RATE_LOW_POWER
+#endif
 
-/* Definitions used to store and retrieve BSEC state from the settings API */
+/* Definitions used to store and retrieve BSEC state from the settings API.
+ * Instance 0 keeps its keys under "bsec", as saved by single sensor
+ * firmware, the other instances use "bsec1", "bsec2"...
+ */
 #define SETTINGS_NAME_BSEC "bsec"
 #define SETTINGS_KEY_STATE "state"
-#define SETTINGS_BSEC_STATE SETTINGS_NAME_BSEC "/" SETTINGS_KEY_STATE
+#define SETTINGS_KEY_RATE "rate"
+#define SETTINGS_KEY_LAST "last"
+
+/* Longest key of an instance, "bsecNN/state/0" */
+#define SETTINGS_BSEC_KEY_LEN 24
+
+/* A slot is assembled in the work buffer, which is free between BSEC calls */
+BUILD_ASSERT(BSEC_MAX_WORKBUFFER_SIZE >=
+	     sizeof(struct bme68x_iaq_slot_header) + BSEC_MAX_STATE_BLOB_SIZE,
+	     "BSEC work buffer too small for a state slot");
+
+BUILD_ASSERT(BSEC_MAX_STATE_BLOB_SIZE <= BME68X_IAQ_STATE_BLOB_MAX,
+	     "BSEC state does not fit an exported state");
+
+/* Requests run by the BSEC work for other threads */
+enum state_request {
+	STATE_REQUEST_NONE,
+	STATE_REQUEST_SAVE,
+	STATE_REQUEST_EXPORT,
+	STATE_REQUEST_IMPORT,
+};
 
-/* Stack size of internal BSEC thread. */
-static K_THREAD_STACK_DEFINE(thread_stack, CONFIG_BME68X_IAQ_THREAD_STACK_SIZE);
+/* Time a request waits for the BSEC work to pick it up */
+#define REQUEST_TIMEOUT K_SECONDS(5)
 
-/* Used for a timeout for when BSEC's state should be saved. */
-static K_TIMER_DEFINE(bsec_save_state_timer, NULL, NULL);
+/* Delay before calling bsec_sensor_control again after it failed */
+#define STEP_RETRY_NS (100 * NSEC_PER_MSEC)
 
-/* Bus spec for BME68x sensor */
-#if BME68x_BUS_SPI
-static struct spi_dt_spec bme68x_spi_spec;
-#elif BME68x_BUS_I2C
-static struct i2c_dt_spec bme68x_i2c_spec;
+#define BSEC_DEVICE_GET(inst) DEVICE_DT_INST_GET(inst),
+
+static const struct device *const bsec_devices[] = {
+	DT_INST_FOREACH_STATUS_OKAY(BSEC_DEVICE_GET)
+};
+
+/* One work queue runs the BSEC work of all instances. The system work
+ * queue also writes settings to flash and samples the battery, which would
+ * delay the BSEC steps.
+ */
+static K_THREAD_STACK_DEFINE(bsec_work_q_stack, CONFIG_BME68X_IAQ_WORKQUEUE_STACK_SIZE);
+static struct k_work_q bsec_work_q;
+
+/* Scratch space needed by bsec_get_state and bsec_set_state for
+ * (de-)serialization, shared since only the BSEC work of the instances,
+ * which all run on bsec_work_q, or their init before the work starts,
+ * calls them.
+ */
+static uint8_t bsec_work_buffer[BSEC_MAX_WORKBUFFER_SIZE];
+
+#if CONFIG_BME68X_IAQ_RTIO
+/* RTIO context queueing the register accesses of all instances, which all
+ * run on bsec_work_q. A forced mode prefetch takes 8 entries.
+ */
+RTIO_DEFINE(bme68x_rtio, 8, 8);
 #endif
 
-/* Semaphore to make sure output data isn't read while being updated */
-static K_SEM_DEFINE(output_sem, 1, 1);
+/* Build the settings key <name> of an instance */
+static void settings_key(const struct device *dev, char *key, size_t size, const char *name)
+{
+	const struct bme68x_iaq_config *config = dev->config;
+
+	snprintk(key, size, "%s/%s", config->settings_name, name);
+}
+
+static int settings_load_legacy(struct bme68x_iaq_data *data, size_t len,
+				settings_read_cb read_cb, void *cb_arg)
+{
+	ssize_t ret;
+
+	/* a slot holds a newer state, or the key was deleted */
+	if (data->state_generation > 0 || len == 0) {
+		return 0;
+	}
+	if (len > ARRAY_SIZE(data->state_buffer)) {
+		return -EINVAL;
+	}
+
+	ret = read_cb(cb_arg, data->state_buffer, len);
+	if (ret <= 0) {
+		LOG_WRN("No settings data read");
+		return -ENODATA;
+	}
+
+	data->state_len = ret;
+	data->state_crc_valid = false;
+	data->state_legacy = true;
+	return 0;
+}
+
+static int settings_load_slot(struct bme68x_iaq_data *data, size_t len,
+			      settings_read_cb read_cb, void *cb_arg)
+{
+	struct bme68x_iaq_slot_header header;
+	ssize_t ret;
+
+	if (len < sizeof(header) || len > sizeof(header) + ARRAY_SIZE(data->state_buffer)) {
+		/* deleted or foreign value, the other slot may still be good */
+		return 0;
+	}
+
+	ret = read_cb(cb_arg, bsec_work_buffer, len);
+	if (ret != (ssize_t)len) {
+		return 0;
+	}
+
+	ret = bme68x_iaq_slot_check(bsec_work_buffer, len, data->state_generation, &header);
+	if (ret < 0) {
+		LOG_WRN("Ignoring corrupted BSEC state slot");
+		return 0;
+	}
+	if (ret == 0) {
+		/* older than the state loaded so far */
+		return 0;
+	}
+
+	memcpy(data->state_buffer, bsec_work_buffer + sizeof(header), header.len);
+	data->state_len = header.len;
+	data->state_generation = header.generation;
+	data->state_crc = header.crc;
+	data->state_crc_valid = true;
+	data->state_legacy = false;
+	return 0;
+}
 
 static int settings_load_handler(const char *key, size_t len,
 				 settings_read_cb read_cb, void *cb_arg, void *param)
+{
+	struct bme68x_iaq_data *data = param;
+
+	if (key == NULL) {
+		return settings_load_legacy(data, len, read_cb, cb_arg);
+	}
+	if (strcmp(key, "0") == 0 || strcmp(key, "1") == 0) {
+		return settings_load_slot(data, len, read_cb, cb_arg);
+	}
+	return 0;
+}
+
+static int settings_rate_load_handler(const char *key, size_t len,
+				      settings_read_cb read_cb, void *cb_arg, void *param)
 {
 	ARG_UNUSED(key);
 	struct bme68x_iaq_data *data = param;
+	int32_t rate;
 
-	if (len > ARRAY_SIZE(data->state_buffer)) {
+	if (len != sizeof(rate) || read_cb(cb_arg, &rate, sizeof(rate)) != sizeof(rate)) {
+		return -EINVAL;
+	}
+
+	if (rate < 0 || (size_t)rate >= ARRAY_SIZE(bsec_sample_rates)) {
+		LOG_WRN("Ignoring invalid sample rate %d", rate);
 		return -EINVAL;
 	}
 
-	data->state_len = read_cb(cb_arg, data->state_buffer, len);
+	atomic_set(&data->sample_rate, rate);
+	atomic_set(&data->stored_sample_rate, rate);
+	return 0;
+}
+
+struct last_outputs {
+	struct bme_sample_result result;
+	bool loaded;
+};
+
+static int settings_last_load_handler(const char *key, size_t len,
+				      settings_read_cb read_cb, void *cb_arg, void *param)
+{
+	ARG_UNUSED(key);
+	struct last_outputs *last = param;
 
-	if (data->state_len > 0) {
+	/* outputs saved by a firmware with another layout are ignored */
+	if (len != sizeof(last->result) ||
+	    read_cb(cb_arg, &last->result, sizeof(last->result)) != sizeof(last->result)) {
 		return 0;
 	}
 
-	LOG_WRN("No settings data read");
-	return -ENODATA;
+	/* the measurement time belongs to the previous boot */
+	last->result.timestamp_ms = 0;
+	last->loaded = true;
+	return 0;
 }
 
+/* Subscribe to all requested outputs, with the gas and temperature, pressure,
+ * humidity outputs at the given BSEC sample rates.
+ */
+static int bsec_subscribe(struct bme68x_iaq_data *data, float gas_rate, float thp_rate)
+{
+	bsec_sensor_configuration_t requested[BSEC_N_REQUESTED_OUTPUTS];
+	size_t n_requested = 0;
+	int ret;
+
+	for (size_t i = 0; i < ARRAY_SIZE(bsec_gas_outputs); ++i) {
+		requested[n_requested].sensor_id = bsec_gas_outputs[i];
+		requested[n_requested].sample_rate = gas_rate;
+		n_requested++;
+	}
+	for (size_t i = 0; i < ARRAY_SIZE(bsec_thp_outputs); ++i) {
+		requested[n_requested].sensor_id = bsec_thp_outputs[i];
+		requested[n_requested].sample_rate = thp_rate;
+		n_requested++;
+	}
 
-/* Export current state of BSEC and save it to flash. */
-static void state_save(const struct device *dev)
+	data->n_required_sensor_settings = ARRAY_SIZE(data->required_sensor_settings);
+	ret = bsec_update_subscription_m(data->bsec_instance, requested, n_requested,
+					 data->required_sensor_settings,
+					 &data->n_required_sensor_settings);
+	if (ret) {
+		LOG_ERR("bsec_update_subscription failed: %d", ret);
+	}
+	return ret;
+}
+
+/* Save the latest outputs, published again at the next boot until BSEC
+ * produces new ones.
+ */
+static int outputs_save(const struct device *dev)
+{
+	struct bme68x_iaq_data *data = dev->data;
+	struct bme_sample_result latest;
+	char key[SETTINGS_BSEC_KEY_LEN];
+	int ret;
+
+	if (!bme68x_iaq_output_available(&data->output)) {
+		return 0;
+	}
+
+	bme68x_iaq_output_read(&data->output, &latest);
+	settings_key(dev, key, sizeof(key), SETTINGS_KEY_LAST);
+	ret = settings_save_one(key, &latest, sizeof(latest));
+	if (ret) {
+		LOG_ERR("storing outputs to flash failed: %d", ret);
+	}
+	return ret;
+}
+
+/* Export the current state of BSEC to the state buffer */
+static int state_get(struct bme68x_iaq_data *data)
+{
+	int ret;
+
+	ret = bsec_get_state_m(data->bsec_instance, 0,
+			       data->state_buffer, ARRAY_SIZE(data->state_buffer),
+			       bsec_work_buffer, ARRAY_SIZE(bsec_work_buffer),
+			       &data->state_len);
+	if (ret != BSEC_OK) {
+		LOG_ERR("bsec_get_state failed: %d", ret);
+		return -EIO;
+	}
+	if (data->state_len <= 0 || data->state_len > sizeof(data->state_buffer)) {
+		LOG_ERR("Invalid BSEC state size: %d", data->state_len);
+		return -EINVAL;
+	}
+	return 0;
+}
+
+/* Export current state of BSEC and save it to flash with the latest
+ * outputs, unless it did not change since the last save. Must run in the
+ * BSEC work.
+ */
+static int state_save(const struct device *dev)
 {
 	int ret;
 	struct bme68x_iaq_data *data = dev->data;
+	char name[sizeof(SETTINGS_KEY_STATE "/0")];
+	char key[SETTINGS_BSEC_KEY_LEN];
+	uint32_t generation;
+	uint32_t crc;
+	size_t len;
 
-	LOG_DBG("saving state to flash");
+	ret = state_get(data);
+	if (ret) {
+		return ret;
+	}
 
-	ret = bsec_get_state(0, data->state_buffer, ARRAY_SIZE(data->state_buffer),
-				data->work_buffer, ARRAY_SIZE(data->work_buffer),
-				&data->state_len);
+	crc = crc32_ieee(data->state_buffer, data->state_len);
+	if (data->state_crc_valid && crc == data->state_crc) {
+		LOG_DBG("state unchanged, not saved");
+		return 0;
+	}
 
-	__ASSERT(ret == BSEC_OK, "bsec_get_state failed.");
-	__ASSERT(data->state_len <= sizeof(data->state_buffer), "state buffer too big to save.");
+	generation = data->state_generation + 1;
+	len = bme68x_iaq_slot_build(bsec_work_buffer, generation,
+				    data->state_buffer, data->state_len);
 
-	ret = settings_save_one(SETTINGS_BSEC_STATE, data->state_buffer, data->state_len);
+	/* write the slot not holding the current state */
+	snprintk(name, sizeof(name), SETTINGS_KEY_STATE "/%s", bme68x_iaq_slot_name(generation));
+	settings_key(dev, key, sizeof(key), name);
+	LOG_DBG("saving state to %s", key);
 
-	__ASSERT(ret == 0, "storing state to flash failed.");
+	ret = settings_save_one(key, bsec_work_buffer, len);
+	if (ret) {
+		LOG_ERR("storing state to flash failed: %d", ret);
+		return ret;
+	}
+
+	data->state_generation = generation;
+	data->state_crc = crc;
+	data->state_crc_valid = true;
+
+	if (data->state_legacy) {
+		data->state_legacy = false;
+		settings_key(dev, key, sizeof(key), SETTINGS_KEY_STATE);
+		ret = settings_delete(key);
+		if (ret) {
+			LOG_WRN("Failed to delete the legacy state: %d", ret);
+		}
+	}
+	return outputs_save(dev);
+}
+
+/* Export the current state with a header for bme68x_iaq_import_state() */
+static int state_export(struct bme68x_iaq_data *data, uint8_t *buf, size_t size)
+{
+	struct bme68x_iaq_state_header header;
+	int ret;
+
+	ret = state_get(data);
+	if (ret) {
+		return ret;
+	}
+	if (size < sizeof(header) + data->state_len) {
+		return -ENOMEM;
+	}
+
+	header.magic = sys_cpu_to_le32(BME68X_IAQ_STATE_MAGIC);
+	header.version = sys_cpu_to_le16(BME68X_IAQ_STATE_VERSION);
+	header.len = sys_cpu_to_le16(data->state_len);
+	header.crc = sys_cpu_to_le32(crc32_ieee(data->state_buffer, data->state_len));
+	memcpy(buf, &header, sizeof(header));
+	memcpy(buf + sizeof(header), data->state_buffer, data->state_len);
+
+	return sizeof(header) + data->state_len;
+}
+
+/* Load a state checked by bme68x_iaq_import_state() and save it */
+static int state_import(const struct device *dev, const uint8_t *buf, size_t len)
+{
+	struct bme68x_iaq_data *data = dev->data;
+	const uint8_t *blob = buf + sizeof(struct bme68x_iaq_state_header);
+	int ret;
+
+	ret = bsec_set_state_m(data->bsec_instance, blob,
+			       len - sizeof(struct bme68x_iaq_state_header),
+			       bsec_work_buffer, ARRAY_SIZE(bsec_work_buffer));
+	if (ret != BSEC_OK) {
+		/* states of another BSEC version or configuration are refused */
+		LOG_ERR("bsec_set_state failed: %d", ret);
+		return -EIO;
+	}
+
+	LOG_INF("BSEC state imported");
+	return state_save(dev);
+}
+
+static int request_handle(const struct device *dev, enum state_request request)
+{
+	struct bme68x_iaq_data *data = dev->data;
+
+	switch (request) {
+	case STATE_REQUEST_SAVE:
+		return state_save(dev);
+	case STATE_REQUEST_EXPORT:
+		return state_export(data, data->request_buf, data->request_len);
+	case STATE_REQUEST_IMPORT:
+		return state_import(dev, data->request_buf, data->request_len);
+	default:
+		return -EINVAL;
+	}
 }
 
-/* I2C bus write forwarder for bme68x driver */
+/* Run a request in the BSEC work and wait for its result */
+static int request_run(const struct device *dev, enum state_request request,
+		       uint8_t *buf, size_t len)
+{
+	struct bme68x_iaq_data *data = dev->data;
+	int ret;
+
+	if (!data->initialized) {
+		return -ENODEV;
+	}
+
+	k_mutex_lock(&data->request_lock, K_FOREVER);
+
+	data->request_buf = buf;
+	data->request_len = len;
+
+	if (k_current_get() == k_work_queue_thread_get(&bsec_work_q)) {
+		ret = request_handle(dev, request);
+		goto unlock;
+	}
+
+	k_sem_reset(&data->request_done);
+	atomic_set(&data->request, request);
+	/* run the work now, it reschedules itself for the pending step */
+	k_work_reschedule_for_queue(&bsec_work_q, &data->work, K_NO_WAIT);
+
+	if (k_sem_take(&data->request_done, REQUEST_TIMEOUT)) {
+		if (atomic_cas(&data->request, request, STATE_REQUEST_NONE)) {
+			ret = -EAGAIN;
+			goto unlock;
+		}
+		/* the BSEC work is using the buffer, wait for it */
+		k_sem_take(&data->request_done, K_FOREVER);
+	}
+	ret = data->request_result;
+
+unlock:
+	k_mutex_unlock(&data->request_lock);
+	return ret;
+}
+
+/* Bus write forwarder for bme68x driver, intf_ptr is the device */
 static int8_t bus_write(uint8_t reg_addr, const uint8_t *reg_data_ptr, uint32_t len, void *intf_ptr)
 {
+	const struct device *dev = intf_ptr;
+	struct bme68x_iaq_data *data = dev->data;
+
 #if BME68x_BUS_SPI
+	const struct bme68x_iaq_config *config = dev->config;
 	const struct spi_buf tx_buf[2] = {
 		{
 			.buf = &reg_addr,
@@ -188,23 +524,23 @@ static int8_t bus_write(uint8_t reg_addr, const uint8_t *reg_data_ptr, uint32_t
 		.count = ARRAY_SIZE(tx_buf),
 	};
 
-	return spi_write_dt(&bme68x_spi_spec, &tx);
+	data->bus.transactions++;
+	data->bus.submissions++;
+	return spi_write_dt(&config->spi, &tx);
 
 #elif BME68x_BUS_I2C
-	uint8_t buf[len + 1];
-
-	buf[0] = reg_addr;
-	memcpy(&buf[1], reg_data_ptr, len);
-
-	return i2c_write_dt(&bme68x_i2c_spec, buf, ARRAY_SIZE(buf));
-
+	return bme68x_iaq_bus_write(&data->bus, reg_addr, reg_data_ptr, len);
 #endif
 }
 
-/* I2C bus read forwarder for bme68x driver */
+/* Bus read forwarder for bme68x driver, intf_ptr is the device */
 static int8_t bus_read(uint8_t reg_addr, uint8_t *reg_data_ptr, uint32_t len, void *intf_ptr)
 {
+	const struct device *dev = intf_ptr;
+	struct bme68x_iaq_data *data = dev->data;
+
 #if BME68x_BUS_SPI
+	const struct bme68x_iaq_config *config = dev->config;
 	const struct spi_buf tx_buf = {
 		.buf = &reg_addr,
 		.len = 1,
@@ -222,68 +558,76 @@ static int8_t bus_read(uint8_t reg_addr, uint8_t *reg_data_ptr, uint32_t len, vo
 		.count = ARRAY_SIZE(rx_buf),
 	};
 
-	return spi_transceive_dt(&bme68x_spi_spec, &tx, &rx);
+	data->bus.transactions++;
+	data->bus.submissions++;
+	return spi_transceive_dt(&config->spi, &tx, &rx);
 
 #elif BME68x_BUS_I2C
-	return i2c_write_read_dt(&bme68x_i2c_spec, &reg_addr, 1, reg_data_ptr, len);
+	return bme68x_iaq_bus_read(&data->bus, reg_addr, reg_data_ptr, len);
 #endif
 }
 
 /* delay function for bme68x driver */
 static void delay_us(uint32_t period, void *intf_ptr)
 {
+	const struct device *dev = intf_ptr;
+	struct bme68x_iaq_data *data = dev->data;
+
+	/* the driver waits for the device to update the registers read ahead */
+	bme68x_iaq_bus_release(&data->bus);
 	k_usleep((int32_t) period);
 }
 
 /* function to handle output of BSEC */
-static void output_ready(const struct device *dev, const bsec_output_t *outputs, uint8_t n_outputs)
+static void output_ready(const struct device *dev, const bsec_output_t *outputs, uint8_t n_outputs,
+			 uint64_t timestamp_ns)
 {
 	struct bme68x_iaq_data *data = dev->data;
 
-	k_sem_take(&output_sem, K_FOREVER);
+	data->pending.timestamp_ms = (int64_t)(timestamp_ns / NSEC_PER_MSEC);
 	for (size_t i = 0; i < n_outputs; ++i) {
 		switch (outputs[i].sensor_id) {
 		case BSEC_OUTPUT_IAQ:
-			data->latest.air_quality = (uint16_t) outputs[i].signal;
-			data->latest.iaq_accuracy = (enum bme68x_accuracy) outputs[i].accuracy;
-			LOG_DBG("IAQ: %d", data->latest.air_quality);
+			data->pending.air_quality = (uint16_t) outputs[i].signal;
+			data->pending.iaq_accuracy = (enum bme68x_accuracy) outputs[i].accuracy;
+			LOG_DBG("IAQ: %d", data->pending.air_quality);
 			break;
 		case BSEC_OUTPUT_CO2_EQUIVALENT:
-			data->latest.co2 = (float) outputs[i].signal;
-			data->latest.co2_accuracy = (enum bme68x_accuracy) outputs[i].accuracy;
-			LOG_DBG("CO2: %.2f ppm", (double)data->latest.co2);
+			data->pending.co2 = (float) outputs[i].signal;
+			data->pending.co2_accuracy = (enum bme68x_accuracy) outputs[i].accuracy;
+			LOG_DBG("CO2: %.2f ppm", (double)data->pending.co2);
 			break;
 		case BSEC_OUTPUT_BREATH_VOC_EQUIVALENT:
-			data->latest.voc = (float) outputs[i].signal;
-			data->latest.voc_accuracy = (enum bme68x_accuracy) outputs[i].accuracy;
-			LOG_DBG("VOC: %.2f ppm", (double)data->latest.voc);
+			data->pending.voc = (float) outputs[i].signal;
+			data->pending.voc_accuracy = (enum bme68x_accuracy) outputs[i].accuracy;
+			LOG_DBG("VOC: %.2f ppm", (double)data->pending.voc);
 			break;
 		case BSEC_OUTPUT_STABILIZATION_STATUS:
-			data->latest.gas_stabilizasion_status = (bool)(outputs[i].signal != 0.0f);
-			LOG_DBG("Gas Stabilization: %d", data->latest.gas_stabilizasion_status);
+			data->pending.gas_stabilizasion_status = (bool)(outputs[i].signal != 0.0f);
+			LOG_DBG("Gas Stabilization: %d", data->pending.gas_stabilizasion_status);
 			break;
 		case BSEC_OUTPUT_RUN_IN_STATUS:
-			data->latest.gas_run_in_status = (bool)(outputs[i].signal != 0.0f);
-			LOG_DBG("Gas Run-in: %d", data->latest.gas_run_in_status);
+			data->pending.gas_run_in_status = (bool)(outputs[i].signal != 0.0f);
+			LOG_DBG("Gas Run-in: %d", data->pending.gas_run_in_status);
 			break;
 		case BSEC_OUTPUT_SENSOR_HEAT_COMPENSATED_TEMPERATURE:
-			data->latest.temperature = (float) outputs[i].signal;
-			LOG_DBG("Temp: %.2f C", (double)data->latest.temperature);
+			data->pending.temperature = (float) outputs[i].signal;
+			LOG_DBG("Temp: %.2f C", (double)data->pending.temperature);
 			break;
 		case BSEC_OUTPUT_RAW_PRESSURE:
-			data->latest.pressure = (float) outputs[i].signal;
-			LOG_DBG("Press: %.2f Pa", (double)data->latest.pressure);
+			data->pending.pressure = (float) outputs[i].signal;
+			LOG_DBG("Press: %.2f Pa", (double)data->pending.pressure);
 			break;
 		case BSEC_OUTPUT_SENSOR_HEAT_COMPENSATED_HUMIDITY:
-			data->latest.humidity = (float) outputs[i].signal;
-			LOG_DBG("Hum: %.2f %%", (double)data->latest.humidity);
+			data->pending.humidity = (float) outputs[i].signal;
+			LOG_DBG("Hum: %.2f %%", (double)data->pending.humidity);
 			break;
 		default:
 			LOG_WRN("unknown bsec output id: %d", outputs[i].sensor_id);
 			break;
 		}
 	}
-	k_sem_give(&output_sem);
+	bme68x_iaq_output_publish(&data->output, &data->pending);
 	if (data->trg_handler != NULL) {
 		data->trg_handler(dev, data->trigger);
 	}
@@ -404,6 +748,13 @@ static int apply_sensor_settings(const struct device *dev, bsec_bme_settings_t s
 
 		bme68x_set_heatr_conf(sensor_settings.op_mode, &heater_config, &data->dev);
 
+		/* the data is fetched once the measurement and heating are done */
+		data->meas_dur_us = bme68x_get_meas_dur(sensor_settings.op_mode, &config,
+							&data->dev);
+		if (sensor_settings.op_mode == BME68X_FORCED_MODE) {
+			data->meas_dur_us += sensor_settings.heater_duration * USEC_PER_MSEC;
+		}
+
 		__fallthrough;
 	case BME68X_SLEEP_MODE:
 		/* this block is executed for all modes */
@@ -427,10 +778,30 @@ static int fetch_and_process_output(const struct device *dev,
 	uint8_t n_outputs = 0;
 	uint8_t n_inputs = 0;
 	bsec_input_t inputs[BSEC_MAX_PHYSICAL_SENSOR] = {0};
-	bsec_output_t outputs[ARRAY_SIZE(bsec_requested_virtual_sensors)] = {0};
+	bsec_output_t outputs[BSEC_N_REQUESTED_OUTPUTS] = {0};
 	struct bme68x_data sensor_data[3] = {0};
 	struct bme68x_iaq_data *data = dev->data;
-	int ret = bme68x_get_data(sensor_settings->op_mode, sensor_data, &n_fields, &data->dev);
+	uint32_t start_cycles = k_cycle_get_32();
+	int ret;
+
+	data->bus.transactions = 0;
+	data->bus.submissions = 0;
+
+	/* with RTIO, the registers are read ahead in one submission. If that
+	 * fails, bme68x_get_data() reads them itself.
+	 */
+	ret = bme68x_iaq_bus_prefetch(&data->bus, sensor_settings->op_mode);
+	if (ret) {
+		LOG_DBG("bme68x register prefetch err: %d", ret);
+	}
+	ret = bme68x_get_data(sensor_settings->op_mode, sensor_data, &n_fields, &data->dev);
+	bme68x_iaq_bus_release(&data->bus);
+
+	if (IS_ENABLED(CONFIG_BME68X_IAQ_BUS_STATS)) {
+		LOG_DBG("bme68x_get_data: %u bus transactions, %u submissions, %u cycles",
+			data->bus.transactions, data->bus.submissions,
+			k_cycle_get_32() - start_cycles);
+	}
 
 	if (ret) {
 		LOG_DBG("bme68x_get_data err: %d", ret);
@@ -438,7 +809,7 @@ static int fetch_and_process_output(const struct device *dev,
 	}
 
 	for (size_t i = 0; i < n_fields; ++i) {
-		n_outputs = ARRAY_SIZE(bsec_requested_virtual_sensors);
+		n_outputs = BSEC_N_REQUESTED_OUTPUTS;
 		n_inputs = sensor_data_to_bsec_inputs(*sensor_settings,
 							sensor_data + i,
 							inputs, timestamp_ns);
@@ -446,132 +817,235 @@ static int fetch_and_process_output(const struct device *dev,
 		if (n_inputs == 0) {
 			continue;
 		}
-		ret = bsec_do_steps(inputs, n_inputs, outputs, &n_outputs);
+		ret = bsec_do_steps_m(data->bsec_instance, inputs, n_inputs, outputs, &n_outputs);
 		if (ret != BSEC_OK) {
 			LOG_ERR("bsec_do_steps err: %d", ret);
 			continue;
 		}
-		output_ready(dev, outputs, n_outputs);
+		output_ready(dev, outputs, n_outputs, timestamp_ns);
 	}
 	return ret;
 }
 
-/* Manage all recurrings tasks for the sensor:
- * - update device settings according to BSEC
- * - fetch measurement values
- * - update BSEC state
- * - periodically save BSEC state to flash
+#if CONFIG_BME68X_IAQ_STACK_STATS
+/* Log the stack high-water mark of the work queue each time it rises */
+static void stack_stats_update(void)
+{
+	static size_t min_unused = SIZE_MAX;
+	struct k_thread *thread = k_work_queue_thread_get(&bsec_work_q);
+	size_t unused;
+
+	if (k_thread_stack_space_get(thread, &unused) || unused >= min_unused) {
+		return;
+	}
+
+	min_unused = unused;
+	LOG_INF("work queue stack high-water mark: %u of %u bytes",
+		(unsigned int)(thread->stack_info.size - unused),
+		(unsigned int)thread->stack_info.size);
+}
+#endif
+
+/* End of a BSEC step: wait for the next call requested by BSEC, and save
+ * the state to flash if the save interval elapsed.
  */
-static void bsec_thread_fn(const struct device *dev)
+static void bsec_step_done(const struct device *dev)
 {
-	int ret;
-	bool wait_for_first_data = true;
 	struct bme68x_iaq_data *data = dev->data;
-	bsec_bme_settings_t sensor_settings = {0};
 
+	data->step = BME68X_IAQ_STEP_CONTROL;
+	data->step_ns = data->sensor_settings.next_call;
 
-	data->n_required_sensor_settings = ARRAY_SIZE(data->required_sensor_settings);
-	ret = bsec_update_subscription(
-		quick_init_sensor_config,
-		ARRAY_SIZE(quick_init_sensor_config),
-		data->required_sensor_settings, &data->n_required_sensor_settings);
-	if (ret) {
-		LOG_ERR("bsec_update_subscription failed: %d", ret);
+	if (k_uptime_get() >= data->next_save_ms) {
+		(void)state_save(dev);
+		data->next_save_ms = k_uptime_get() +
+				     CONFIG_BME68X_IAQ_SAVE_INTERVAL_MINUTES * 60 * MSEC_PER_SEC;
 	}
+}
 
-	while (true) {
-		uint64_t timestamp_ns = k_ticks_to_ns_near64(k_uptime_ticks());
-
-		if (timestamp_ns < sensor_settings.next_call) {
-			k_sleep(K_NSEC(sensor_settings.next_call - timestamp_ns));
-			continue; /* restart to get new timestamp */
+/* Run the due step of an instance and set when the next one is due:
+ * - control: get the device settings of the next measurement from BSEC
+ * - apply: update device settings, starting the measurement
+ * - fetch: after the measurement duration, fetch the measurement values
+ *   and update the BSEC state
+ */
+static void bsec_step_run(const struct device *dev, uint64_t timestamp_ns)
+{
+	int ret;
+	struct bme68x_iaq_data *data = dev->data;
+	bsec_bme_settings_t *sensor_settings = &data->sensor_settings;
+
+	switch (data->step) {
+	case BME68X_IAQ_STEP_CONTROL:
+		/* apply a sample mode change requested with sensor_attr_set() */
+		if (!data->wait_for_first_data &&
+		    data->active_sample_rate != atomic_get(&data->sample_rate)) {
+			data->active_sample_rate = atomic_get(&data->sample_rate);
+			LOG_DBG("%s: switching to sample rate %d", dev->name,
+				(int)data->active_sample_rate);
+			bsec_subscribe(data, bsec_sample_rates[data->active_sample_rate].gas,
+				       bsec_sample_rates[data->active_sample_rate].thp);
 		}
-		memset(&sensor_settings, 0, sizeof(sensor_settings));
 
-		ret = bsec_sensor_control((int64_t)timestamp_ns, &sensor_settings);
+		memset(sensor_settings, 0, sizeof(*sensor_settings));
+
+		ret = bsec_sensor_control_m(data->bsec_instance, (int64_t)timestamp_ns,
+					    sensor_settings);
 		if (ret != BSEC_OK) {
 			LOG_ERR("bsec_sensor_control err: %d", ret);
-			continue; /* retry */
+			data->step_ns = timestamp_ns + STEP_RETRY_NS;
+			return; /* retry */
 		}
 
-		ret = apply_sensor_settings(dev, sensor_settings);
+		data->step_timestamp_ns = timestamp_ns;
+		data->step = BME68X_IAQ_STEP_APPLY;
+		data->step_ns = timestamp_ns;
+		break;
+
+	case BME68X_IAQ_STEP_APPLY:
+		ret = apply_sensor_settings(dev, *sensor_settings);
 		if (ret) {
 			LOG_ERR("apply_sensor_settings failed: %d", ret);
-			continue; /* retry */
+			bsec_step_done(dev); /* retry at the next call */
+			return;
 		}
 
-		if (sensor_settings.trigger_measurement &&
-		    sensor_settings.op_mode != BME68X_SLEEP_MODE) {
-			ret = fetch_and_process_output(dev, &sensor_settings, timestamp_ns);
-			if ((ret == BSEC_OK) && wait_for_first_data) {
-				/* sensor values initialized, switch to regular settings */
-				LOG_DBG("switching to regular interval");
-				wait_for_first_data = false;
-				data->n_required_sensor_settings =
-					ARRAY_SIZE(data->required_sensor_settings);
-				ret = bsec_update_subscription(
-					bsec_requested_virtual_sensors,
-					ARRAY_SIZE(bsec_requested_virtual_sensors),
-					data->required_sensor_settings,
-					&data->n_required_sensor_settings);
-				if (ret) {
-					LOG_ERR("bsec_update_subscription failed: %d", ret);
-				}
-			}
-			if (ret) {
-				LOG_DBG("fetch_and_process_output failed: %d", ret);
-			}
+		if (sensor_settings->trigger_measurement &&
+		    sensor_settings->op_mode != BME68X_SLEEP_MODE) {
+			data->step = BME68X_IAQ_STEP_FETCH;
+			data->step_ns = timestamp_ns + (uint64_t)data->meas_dur_us * NSEC_PER_USEC;
+		} else {
+			bsec_step_done(dev);
 		}
+		break;
 
-		/* if save timer is expired, save and restart timer */
-		if (k_timer_remaining_get(&bsec_save_state_timer) == 0) {
-			state_save(dev);
-			k_timer_start(&bsec_save_state_timer,
-				      K_MINUTES(CONFIG_BME68X_IAQ_SAVE_INTERVAL_MINUTES),
-				      K_NO_WAIT);
+	case BME68X_IAQ_STEP_FETCH:
+		ret = fetch_and_process_output(dev, sensor_settings, data->step_timestamp_ns);
+		if ((ret == BSEC_OK) && data->wait_for_first_data) {
+			/* sensor values initialized, switch to regular settings */
+			LOG_DBG("%s: switching to regular interval", dev->name);
+			data->wait_for_first_data = false;
+			data->active_sample_rate = atomic_get(&data->sample_rate);
+			ret = bsec_subscribe(data, bsec_sample_rates[data->active_sample_rate].gas,
+					     bsec_sample_rates[data->active_sample_rate].thp);
+		}
+		if (ret) {
+			LOG_DBG("fetch_and_process_output failed: %d", ret);
 		}
+		bsec_step_done(dev);
+		break;
+	}
+}
+
+/* Handle the requests of other threads, run the steps that are due and
+ * schedule the work for the next one.
+ */
+static void bsec_work_handler(struct k_work *work)
+{
+	struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+	struct bme68x_iaq_data *data = CONTAINER_OF(dwork, struct bme68x_iaq_data, work);
+	const struct device *dev = data->device;
+	uint64_t timestamp_ns;
+
+	/* state save, export or import requested by another thread */
+	enum state_request request = atomic_set(&data->request, STATE_REQUEST_NONE);
+
+	if (request != STATE_REQUEST_NONE) {
+		data->request_result = request_handle(dev, request);
+		k_sem_give(&data->request_done);
+	}
+
+	/* a request runs the work early, before any step is due */
+	timestamp_ns = k_ticks_to_ns_near64(k_uptime_ticks());
+	while (timestamp_ns >= data->step_ns) {
+		bsec_step_run(dev, timestamp_ns);
+		timestamp_ns = k_ticks_to_ns_near64(k_uptime_ticks());
 	}
 
+#if CONFIG_BME68X_IAQ_STACK_STATS
+	stack_stats_update();
+#endif
+
+	k_work_reschedule_for_queue(&bsec_work_q, dwork, K_NSEC(data->step_ns - timestamp_ns));
+}
+
+/* Start the BSEC work of all instances once they are all initialized, as
+ * their init uses the shared work buffer.
+ */
+static int bsec_work_start(void)
+{
+	const struct k_work_queue_config cfg = {
+		.name = "bsec_workq",
+	};
+
+	k_work_queue_start(&bsec_work_q, bsec_work_q_stack,
+			   K_THREAD_STACK_SIZEOF(bsec_work_q_stack),
+			   CONFIG_BME68X_IAQ_WORKQUEUE_PRIORITY, &cfg);
+
+	for (size_t i = 0; i < ARRAY_SIZE(bsec_devices); i++) {
+		struct bme68x_iaq_data *data = bsec_devices[i]->data;
+
+		if (data->initialized) {
+			k_work_schedule_for_queue(&bsec_work_q, &data->work, K_NO_WAIT);
+		}
+	}
+	return 0;
 }
 
+SYS_INIT(bsec_work_start, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
+
 static int bme68x_bsec_init(const struct device *dev)
 {
 	int err;
 	struct bme68x_iaq_data *data = dev->data;
 	const struct bme68x_iaq_config *config = dev->config;
+	char key[SETTINGS_BSEC_KEY_LEN];
 
-#if BME68x_BUS_SPI
-	bme68x_spi_spec = config->spi;
-#elif BME68x_BUS_I2C
-	bme68x_i2c_spec = config->i2c;
-#endif
 	err = settings_subsys_init();
 	if (err) {
 		LOG_ERR("settings_subsys_init, error: %d", err);
 		return err;
 	}
 
-	err = settings_load_subtree_direct(SETTINGS_BSEC_STATE, settings_load_handler, data);
+	k_mutex_init(&data->request_lock);
+	k_sem_init(&data->request_done, 0, 1);
+
+	settings_key(dev, key, sizeof(key), SETTINGS_KEY_STATE);
+	err = settings_load_subtree_direct(key, settings_load_handler, data);
+	if (err) {
+		LOG_ERR("settings_load_subtree, error: %d", err);
+		return err;
+	}
+
+	atomic_set(&data->sample_rate, BSEC_DEFAULT_SAMPLE_RATE);
+	atomic_set(&data->stored_sample_rate, BSEC_DEFAULT_SAMPLE_RATE);
+	settings_key(dev, key, sizeof(key), SETTINGS_KEY_RATE);
+	err = settings_load_subtree_direct(key, settings_rate_load_handler, data);
 	if (err) {
 		LOG_ERR("settings_load_subtree, error: %d", err);
 		return err;
 	}
 
 #if BME68x_BUS_SPI
-	if (!spi_is_ready_dt(&bme68x_spi_spec)) {
+	if (!spi_is_ready_dt(&config->spi)) {
 		LOG_ERR("SPI device not ready");
 		return -ENODEV;
 	}
 	data->dev.intf = BME68X_SPI_INTF;
 #elif BME68x_BUS_I2C
-	if (!device_is_ready(bme68x_i2c_spec.bus)) {
+	if (!device_is_ready(config->i2c.bus)) {
 		LOG_ERR("I2C device not ready");
 		return -ENODEV;
 	}
 	data->dev.intf = BME68X_I2C_INTF;
+	data->bus.i2c = &config->i2c;
+#if CONFIG_BME68X_IAQ_RTIO
+	data->bus.rtio = &bme68x_rtio;
+	data->bus.iodev = config->iodev;
+#endif
 #endif
 
-	data->dev.intf_ptr = NULL;
+	data->dev.intf_ptr = (void *)dev;
 	data->dev.read = bus_read;
 	data->dev.write = bus_write;
 	data->dev.delay_us = delay_us;
@@ -583,29 +1057,62 @@ static int bme68x_bsec_init(const struct device *dev)
 		return err;
 	}
 
-	err = bsec_init();
+	if (bsec_get_instance_size_m() > sizeof(data->bsec_instance)) {
+		LOG_ERR("BSEC instance does not fit: %u",
+			(unsigned int)bsec_get_instance_size_m());
+		return -ENOMEM;
+	}
+
+	err = bsec_init_m(data->bsec_instance);
 	if (err != BSEC_OK) {
 		LOG_ERR("Failed to init BSEC: %d", err);
 		return err;
 	}
 
-	err = bsec_set_state(data->state_buffer, data->state_len,
-			     data->work_buffer, ARRAY_SIZE(data->work_buffer));
+	err = bsec_set_state_m(data->bsec_instance, data->state_buffer, data->state_len,
+			       bsec_work_buffer, ARRAY_SIZE(bsec_work_buffer));
 	if (err != BSEC_OK && err != BSEC_E_CONFIG_EMPTY) {
 		LOG_ERR("Failed to set BSEC state: %d", err);
 	} else if (err == BSEC_OK) {
 		LOG_DBG("Setting BSEC state successful.");
 	}
+	data->state_restored = (err == BSEC_OK && data->state_len > 0);
+
+	/* publish the outputs of the previous boot until BSEC has new ones */
+	struct last_outputs last = {0};
+
+	settings_key(dev, key, sizeof(key), SETTINGS_KEY_LAST);
+	err = settings_load_subtree_direct(key, settings_last_load_handler, &last);
+	if (err) {
+		LOG_WRN("Failed to load the last outputs: %d", err);
+	} else if (last.loaded) {
+		data->pending = last.result;
+		bme68x_iaq_output_publish(&data->output, &data->pending);
+	}
 
-	k_thread_create(&data->thread,
-			thread_stack,
-			CONFIG_BME68X_IAQ_THREAD_STACK_SIZE,
-			(k_thread_entry_t)bsec_thread_fn,
-			(void *)dev, NULL, NULL, K_LOWEST_APPLICATION_THREAD_PRIO, 0, K_NO_WAIT);
+	data->wait_for_first_data = !data->state_restored;
+	data->active_sample_rate = atomic_get(&data->sample_rate);
+	if (data->wait_for_first_data) {
+		/* run at the continuous rate until the first output is available */
+		bsec_subscribe(data, BSEC_SAMPLE_RATE_CONT, BSEC_SAMPLE_RATE_CONT);
+	} else {
+		/* a restored state is already calibrated, start at the regular rate */
+		LOG_DBG("%s: warm start at sample rate %d", dev->name,
+			(int)data->active_sample_rate);
+		bsec_subscribe(data, bsec_sample_rates[data->active_sample_rate].gas,
+			       bsec_sample_rates[data->active_sample_rate].thp);
+	}
+
+	data->next_save_ms = k_uptime_get() +
+			     CONFIG_BME68X_IAQ_SAVE_INTERVAL_MINUTES * 60 * MSEC_PER_SEC;
 
-	k_timer_start(&bsec_save_state_timer,
-		      K_MINUTES(CONFIG_BME68X_IAQ_SAVE_INTERVAL_MINUTES),
-		      K_NO_WAIT);
+	data->device = dev;
+	data->step = BME68X_IAQ_STEP_CONTROL;
+	data->step_ns = 0;
+	k_work_init_delayable(&data->work, bsec_work_handler);
+
+	/* the work is started by bsec_work_start() */
+	data->initialized = true;
 	return 0;
 }
 
@@ -636,6 +1143,66 @@ static int bme68x_trigger_set(const struct device *dev,
 	return 0;
 }
 
+static int bme68x_attr_set(const struct device *dev,
+			   enum sensor_channel chan,
+			   enum sensor_attribute attr,
+			   const struct sensor_value *val)
+{
+	struct bme68x_iaq_data *data = dev->data;
+	int32_t rate = val->val1;
+	char key[SETTINGS_BSEC_KEY_LEN];
+	int ret;
+
+	if (chan != SENSOR_CHAN_ALL ||
+	    (attr != (enum sensor_attribute)SENSOR_ATTR_BME68X_IAQ_SAMPLE_RATE &&
+	     attr != (enum sensor_attribute)SENSOR_ATTR_BME68X_IAQ_SAMPLE_RATE_RUNTIME)) {
+		LOG_ERR("Unsupported sensor attribute");
+		return -ENOTSUP;
+	}
+
+	if (rate < 0 || (size_t)rate >= ARRAY_SIZE(bsec_sample_rates)) {
+		return -EINVAL;
+	}
+
+	/* the BSEC work picks up the new rate before its next control step */
+	atomic_set(&data->sample_rate, rate);
+	if (attr == (enum sensor_attribute)SENSOR_ATTR_BME68X_IAQ_SAMPLE_RATE_RUNTIME) {
+		return 0;
+	}
+	atomic_set(&data->stored_sample_rate, rate);
+
+	/* the settings backend skips writing a value it already holds */
+	settings_key(dev, key, sizeof(key), SETTINGS_KEY_RATE);
+	ret = settings_save_one(key, &rate, sizeof(rate));
+	if (ret) {
+		LOG_ERR("storing sample rate failed: %d", ret);
+	}
+	return ret;
+}
+
+static int bme68x_attr_get(const struct device *dev,
+			   enum sensor_channel chan,
+			   enum sensor_attribute attr,
+			   struct sensor_value *val)
+{
+	struct bme68x_iaq_data *data = dev->data;
+
+	if (chan != SENSOR_CHAN_ALL ||
+	    (attr != (enum sensor_attribute)SENSOR_ATTR_BME68X_IAQ_SAMPLE_RATE &&
+	     attr != (enum sensor_attribute)SENSOR_ATTR_BME68X_IAQ_SAMPLE_RATE_RUNTIME)) {
+		LOG_ERR("Unsupported sensor attribute");
+		return -ENOTSUP;
+	}
+
+	if (attr == (enum sensor_attribute)SENSOR_ATTR_BME68X_IAQ_SAMPLE_RATE) {
+		val->val1 = atomic_get(&data->stored_sample_rate);
+	} else {
+		val->val1 = atomic_get(&data->sample_rate);
+	}
+	val->val2 = 0;
+	return 0;
+}
+
 static int bme68x_sample_fetch(const struct device *dev, enum sensor_channel chan)
 {
 	/* fetching is a requirement for the API */
@@ -647,63 +1214,132 @@ static int bme68x_channel_get(const struct device *dev,
 			      struct sensor_value *val)
 {
 	struct bme68x_iaq_data *data = dev->data;
+	struct bme_sample_result latest;
 	int result = 0;
 
-	k_sem_take(&output_sem, K_FOREVER);
+	bme68x_iaq_output_read(&data->output, &latest);
 	if (chan == SENSOR_CHAN_HUMIDITY) {
-		sensor_value_from_float(val, data->latest.humidity);
+		sensor_value_from_float(val, latest.humidity);
 	} else if (chan == SENSOR_CHAN_AMBIENT_TEMP) {
-		sensor_value_from_float(val, data->latest.temperature);
+		sensor_value_from_float(val, latest.temperature);
 	} else if (chan == SENSOR_CHAN_PRESS) {
-		sensor_value_from_float(val, data->latest.pressure);
+		sensor_value_from_float(val, latest.pressure);
 	} else if (chan == SENSOR_CHAN_IAQ) {
-		val->val1 = data->latest.air_quality;
+		val->val1 = latest.air_quality;
 		val->val2 = 0;
 	} else if (chan == SENSOR_CHAN_CO2) {
-		sensor_value_from_float(val, data->latest.co2);
+		sensor_value_from_float(val, latest.co2);
 	} else if (chan == SENSOR_CHAN_VOC) {
-		sensor_value_from_float(val, data->latest.voc);
+		sensor_value_from_float(val, latest.voc);
 	} else if (chan == SENSOR_CHAN_IAQ_ACC) {
-		val->val1 = data->latest.iaq_accuracy;
+		val->val1 = latest.iaq_accuracy;
 		val->val2 = 0;
 	} else if (chan == SENSOR_CHAN_CO2_ACC) {
-		val->val1 = data->latest.co2_accuracy;
+		val->val1 = latest.co2_accuracy;
 		val->val2 = 0;
 	} else if (chan == SENSOR_CHAN_VOC_ACC) {
-		val->val1 = data->latest.voc_accuracy;
+		val->val1 = latest.voc_accuracy;
 		val->val2 = 0;
 	} else if (chan == SENSOR_CHAN_GAS_RUN_IN) {
-		val->val1 = data->latest.gas_run_in_status;
+		val->val1 = latest.gas_run_in_status;
 		val->val2 = 0;
 	} else if (chan == SENSOR_CHAN_GAS_STAB) {
-		val->val1 = data->latest.gas_stabilizasion_status;
+		val->val1 = latest.gas_stabilizasion_status;
 		val->val2 = 0;
 	} else {
 		LOG_ERR("Unsupported sensor channel");
 		result = -ENOTSUP;
 	}
-	k_sem_give(&output_sem);
 	return result;
 }
 
+int bme68x_iaq_save_state(const struct device *dev)
+{
+	return request_run(dev, STATE_REQUEST_SAVE, NULL, 0);
+}
+
+int bme68x_iaq_export_state(const struct device *dev, uint8_t *buf, size_t size)
+{
+	return request_run(dev, STATE_REQUEST_EXPORT, buf, size);
+}
+
+int bme68x_iaq_import_state(const struct device *dev, const uint8_t *buf, size_t len)
+{
+	struct bme68x_iaq_state_header header;
+
+	if (len < sizeof(header)) {
+		return -EINVAL;
+	}
+
+	memcpy(&header, buf, sizeof(header));
+	if (sys_le32_to_cpu(header.magic) != BME68X_IAQ_STATE_MAGIC) {
+		return -EINVAL;
+	}
+	if (sys_le16_to_cpu(header.version) != BME68X_IAQ_STATE_VERSION) {
+		return -ENOTSUP;
+	}
+	if (sys_le16_to_cpu(header.len) == 0 ||
+	    sys_le16_to_cpu(header.len) > BSEC_MAX_STATE_BLOB_SIZE ||
+	    len != sizeof(header) + sys_le16_to_cpu(header.len)) {
+		return -EINVAL;
+	}
+	if (sys_le32_to_cpu(header.crc) != crc32_ieee(buf + sizeof(header), len - sizeof(header))) {
+		return -EBADMSG;
+	}
+
+	/* the buffer is only read by the BSEC work */
+	return request_run(dev, STATE_REQUEST_IMPORT, (uint8_t *)buf, len);
+}
+
+int bme68x_iaq_get_snapshot(const struct device *dev, struct bme_sample_result *out)
+{
+	struct bme68x_iaq_data *data = dev->data;
+
+	if (!bme68x_iaq_output_available(&data->output)) {
+		return -ENODATA;
+	}
+
+	bme68x_iaq_output_read(&data->output, out);
+	return 0;
+}
+
 static const struct sensor_driver_api bme68x_driver_api = {
+	.attr_set = &bme68x_attr_set,
+	.attr_get = &bme68x_attr_get,
 	.sample_fetch = &bme68x_sample_fetch,
 	.channel_get = &bme68x_channel_get,
 	.trigger_set = bme68x_trigger_set,
 };
 
-/* there can be only one device supported here because of BSECs internal state */
-static struct bme68x_iaq_config config_0 = {
 #if BME68x_BUS_SPI
-	.spi = SPI_DT_SPEC_INST_GET(0, BME68x_SPI_OPERATION, 0),
+#define BME68X_IAQ_BUS(inst) .spi = SPI_DT_SPEC_INST_GET(inst, BME68x_SPI_OPERATION, 0),
 #elif BME68x_BUS_I2C
-	.i2c = I2C_DT_SPEC_INST_GET(0),
+#define BME68X_IAQ_BUS(inst) .i2c = I2C_DT_SPEC_INST_GET(inst),
+#endif
+
+#if CONFIG_BME68X_IAQ_RTIO
+#define BME68X_IAQ_IODEV_DEFINE(inst) I2C_DT_IODEV_DEFINE(bme68x_iodev_##inst, DT_DRV_INST(inst));
+#define BME68X_IAQ_IODEV(inst) .iodev = &bme68x_iodev_##inst,
+#else
+#define BME68X_IAQ_IODEV_DEFINE(inst)
+#define BME68X_IAQ_IODEV(inst)
 #endif
-};
-static struct bme68x_iaq_data data_0;
 
-SENSOR_DEVICE_DT_INST_DEFINE(0, bme68x_bsec_init, NULL,
-			      &data_0,
-			      &config_0,
-			      POST_KERNEL, CONFIG_SENSOR_INIT_PRIORITY,
-			      &bme68x_driver_api);
+/* Each instance has its own BSEC context and work, on bsec_work_q */
+#define BME68X_IAQ_DEFINE(inst)								\
+	BME68X_IAQ_IODEV_DEFINE(inst)							\
+	static const struct bme68x_iaq_config config_##inst = {				\
+		BME68X_IAQ_BUS(inst)							\
+		BME68X_IAQ_IODEV(inst)							\
+		.settings_name = COND_CODE_0(inst, (SETTINGS_NAME_BSEC),		\
+					     (SETTINGS_NAME_BSEC STRINGIFY(inst))),	\
+	};										\
+	static struct bme68x_iaq_data data_##inst;					\
+											\
+	SENSOR_DEVICE_DT_INST_DEFINE(inst, bme68x_bsec_init, NULL,			\
+				     &data_##inst,					\
+				     &config_##inst,					\
+				     POST_KERNEL, CONFIG_SENSOR_INIT_PRIORITY,		\
+				     &bme68x_driver_api);
+
+DT_INST_FOREACH_STATUS_OKAY(BME68X_IAQ_DEFINE)
@@ -8,10 +8,16 @@
 
 #include <zephyr/kernel.h>
 #include <zephyr/devicetree.h>
+#include <zephyr/sys/atomic.h>
 
 #include "bsec_interface.h"
+#include "bsec_interface_multi.h"
 #include "bme68x.h"
 #include <drivers/bme68x_iaq.h>
+#include <drivers/bme68x_iaq_ext.h>
+
+#include "bme68x_iaq_output.h"
+#include "bme68x_iaq_bus.h"
 
 #ifndef ZEPHYR_DRIVERS_SENSOR_BME68X_NCS
 #define ZEPHYR_DRIVERS_SENSOR_BME68X_NCS
@@ -36,41 +42,78 @@
 	(SPI_WORD_SET(8) | SPI_TRANSFER_MSB | SPI_MODE_CPOL | SPI_MODE_CPHA | SPI_OP_MODE_MASTER)
 #endif
 
-struct bme_sample_result {
-	float temperature;
-	float humidity;
-	float pressure;
-	uint16_t air_quality;
-
-	float co2;
-	float voc;
-
-	enum bme68x_accuracy iaq_accuracy;
-	enum bme68x_accuracy co2_accuracy;
-	enum bme68x_accuracy voc_accuracy;
-
-	bool gas_run_in_status;
-	bool gas_stabilizasion_status;
-};
-
 struct bme68x_iaq_config {
 #if BME68x_BUS_SPI
 	const struct spi_dt_spec spi;
 #elif BME68x_BUS_I2C
 	const struct i2c_dt_spec i2c;
 #endif
+#if CONFIG_BME68X_IAQ_RTIO
+	/* RTIO device queueing the register accesses of this instance */
+	struct rtio_iodev *iodev;
+#endif
+	/* Settings subtree of this instance, "bsec" for instance 0 */
+	const char *settings_name;
+};
+
+/* Steps of the BSEC work of an instance */
+enum bme68x_iaq_step {
+	BME68X_IAQ_STEP_CONTROL,
+	BME68X_IAQ_STEP_APPLY,
+	BME68X_IAQ_STEP_FETCH,
 };
 
 struct bme68x_iaq_data {
-	/* Variable to store intermediate sample result */
-	struct bme_sample_result latest;
+	/* Sample assembled from BSEC outputs, only accessed by the BSEC work */
+	struct bme_sample_result pending;
+
+	/* Published samples, written by the BSEC work only */
+	struct bme68x_iaq_output output;
+
+	/* Sample mode, one of enum bme68x_iaq_sample_rate */
+	atomic_t sample_rate;
+	/* Sample mode stored in the settings, sample_rate unless a runtime
+	 * mode overrides it
+	 */
+	atomic_t stored_sample_rate;
 
 	/* Trigger and corresponding handler */
 	sensor_trigger_handler_t trg_handler;
 	const struct sensor_trigger *trigger;
 
-	/* Internal BSEC thread metadata value. */
-	struct k_thread thread;
+	/* BSEC context of this instance, for the bsec_*_m functions */
+	uint8_t bsec_instance[BSEC_INSTANCE_SIZE] __aligned(4);
+
+	/* Work running the BSEC steps of this instance, and its device */
+	struct k_work_delayable work;
+	const struct device *device;
+
+	/* Next step, due at step_ns in uptime nanoseconds */
+	enum bme68x_iaq_step step;
+	uint64_t step_ns;
+
+	/* Time of the last bsec_sensor_control call, the measurement time */
+	uint64_t step_timestamp_ns;
+
+	/* Duration of the measurement started by the apply step */
+	uint32_t meas_dur_us;
+
+	/* Sensor settings of the current BSEC step, next_call is when the
+	 * next control step is due
+	 */
+	bsec_bme_settings_t sensor_settings;
+
+	/* Running at the continuous rate until the first output is available */
+	bool wait_for_first_data;
+
+	/* Sample mode BSEC is subscribed at */
+	atomic_val_t active_sample_rate;
+
+	/* Uptime at which the state is saved next */
+	int64_t next_save_ms;
+
+	/* Register accesses, and their counters for CONFIG_BME68X_IAQ_BUS_STATS */
+	struct bme68x_iaq_bus bus;
 
 	/* Buffer used to maintain the BSEC library state. */
 	uint8_t state_buffer[BSEC_MAX_STATE_BLOB_SIZE];
@@ -78,12 +121,33 @@ struct bme68x_iaq_data {
 	/* Size of the saved state */
 	int32_t state_len;
 
+	/* Generation and CRC of the state last saved or loaded, generation 0
+	 * if none was, or if it came from the legacy settings key.
+	 */
+	uint32_t state_generation;
+	uint32_t state_crc;
+	bool state_crc_valid;
+	bool state_legacy;
+
+	/* BSEC was initialized with a saved state, so the continuous rate
+	 * quick start is skipped
+	 */
+	bool state_restored;
+
+	/* State request of another thread, run by the BSEC work since the
+	 * BSEC library is not reentrant. One request at a time.
+	 */
+	struct k_mutex request_lock;
+	atomic_t request;
+	uint8_t *request_buf;
+	size_t request_len;
+	int request_result;
+	struct k_sem request_done;
+
 	bsec_sensor_configuration_t required_sensor_settings[BSEC_MAX_PHYSICAL_SENSOR];
 	uint8_t n_required_sensor_settings;
 
-	/* some RAM space needed by bsec_get_state and bsec_set_state for (de-)serialization. */
-	uint8_t work_buffer[BSEC_MAX_WORKBUFFER_SIZE];
-
+	/* Set once the instance is ready for the BSEC work */
 	bool initialized;
 
 	struct bme68x_dev dev;
@@ -0,0 +1,198 @@
+/*
+ * Copyright (c) 2023 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include "bme68x_iaq_bus.h"
+
+#if CONFIG_BME68X_IAQ_RTIO
+/* Register blocks read by bme68x_get_data() */
+struct reg_block {
+	uint8_t reg;
+	uint8_t len;
+};
+
+/* Forced mode reads the first field, then the heater registers of its
+ * profile, which is always 0
+ */
+static const struct reg_block forced_blocks[] = {
+	{BME68X_REG_FIELD0, BME68X_LEN_FIELD},
+	{BME68X_REG_RES_HEAT0, 1},
+	{BME68X_REG_IDAC_HEAT0, 1},
+	{BME68X_REG_GAS_WAIT0, 1},
+};
+
+/* Parallel and sequential modes read the three fields, then the heater
+ * registers of all profiles
+ */
+static const struct reg_block all_blocks[] = {
+	{BME68X_REG_FIELD0, BME68X_LEN_FIELD * 3},
+	{BME68X_REG_IDAC_HEAT0, BME68X_IAQ_BUS_SHADOW_START + BME68X_IAQ_BUS_SHADOW_LEN -
+				BME68X_REG_IDAC_HEAT0},
+};
+
+/* Queue the transaction writing the register address, then reading or
+ * writing len bytes
+ */
+static int queue_transaction(struct bme68x_iaq_bus *bus, uint8_t reg, uint8_t *data,
+			     uint32_t len, bool read)
+{
+	struct rtio_sqe *addr_sqe = rtio_sqe_acquire(bus->rtio);
+	struct rtio_sqe *data_sqe = rtio_sqe_acquire(bus->rtio);
+
+	if (addr_sqe == NULL || data_sqe == NULL) {
+		return -ENOMEM;
+	}
+
+	/* the address is copied into the entry, the payload is not */
+	rtio_sqe_prep_tiny_write(addr_sqe, bus->iodev, RTIO_PRIO_NORM, &reg, sizeof(reg), NULL);
+	addr_sqe->flags |= RTIO_SQE_TRANSACTION;
+	if (read) {
+		rtio_sqe_prep_read(data_sqe, bus->iodev, RTIO_PRIO_NORM, data, len, NULL);
+		data_sqe->iodev_flags |= RTIO_IODEV_I2C_STOP | RTIO_IODEV_I2C_RESTART;
+	} else {
+		rtio_sqe_prep_write(data_sqe, bus->iodev, RTIO_PRIO_NORM, data, len, NULL);
+		data_sqe->iodev_flags |= RTIO_IODEV_I2C_STOP;
+	}
+	bus->transactions++;
+	return 0;
+}
+
+/* Submit the queued entries, sleep until they all completed and return the
+ * first error
+ */
+static int submit(struct bme68x_iaq_bus *bus, uint32_t count)
+{
+	struct rtio_cqe *cqe;
+	int ret;
+
+	bus->submissions++;
+	ret = rtio_submit(bus->rtio, count);
+	while ((cqe = rtio_cqe_consume(bus->rtio)) != NULL) {
+		if (ret == 0) {
+			ret = cqe->result;
+		}
+		rtio_cqe_release(bus->rtio, cqe);
+	}
+	return ret;
+}
+
+static int transfer(struct bme68x_iaq_bus *bus, uint8_t reg, uint8_t *data, uint32_t len,
+		    bool read)
+{
+	int ret = queue_transaction(bus, reg, data, len, read);
+
+	if (ret) {
+		rtio_sqe_drop_all(bus->rtio);
+		return ret;
+	}
+	return submit(bus, 2);
+}
+
+/* Whether reg to reg + len were all read ahead */
+static bool shadow_has(const struct bme68x_iaq_bus *bus, uint8_t reg, uint32_t len)
+{
+	if (reg < BME68X_IAQ_BUS_SHADOW_START ||
+	    reg + len > BME68X_IAQ_BUS_SHADOW_START + BME68X_IAQ_BUS_SHADOW_LEN) {
+		return false;
+	}
+	for (uint32_t i = 0; i < len; i++) {
+		if (!bus->shadow_valid[reg - BME68X_IAQ_BUS_SHADOW_START + i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+int bme68x_iaq_bus_prefetch(struct bme68x_iaq_bus *bus, uint8_t op_mode)
+{
+	const struct reg_block *blocks = forced_blocks;
+	size_t count = ARRAY_SIZE(forced_blocks);
+	int ret;
+
+	if (op_mode != BME68X_FORCED_MODE) {
+		blocks = all_blocks;
+		count = ARRAY_SIZE(all_blocks);
+	}
+
+	bme68x_iaq_bus_release(bus);
+	for (size_t i = 0; i < count; i++) {
+		ret = queue_transaction(bus, blocks[i].reg,
+					&bus->shadow[blocks[i].reg - BME68X_IAQ_BUS_SHADOW_START],
+					blocks[i].len, true);
+		if (ret) {
+			rtio_sqe_drop_all(bus->rtio);
+			return ret;
+		}
+	}
+
+	/* one wakeup for all the blocks */
+	ret = submit(bus, 2 * count);
+	if (ret) {
+		return ret;
+	}
+
+	for (size_t i = 0; i < count; i++) {
+		memset(&bus->shadow_valid[blocks[i].reg - BME68X_IAQ_BUS_SHADOW_START], true,
+		       blocks[i].len);
+	}
+	return 0;
+}
+
+void bme68x_iaq_bus_release(struct bme68x_iaq_bus *bus)
+{
+	memset(bus->shadow_valid, false, sizeof(bus->shadow_valid));
+}
+
+int bme68x_iaq_bus_write(struct bme68x_iaq_bus *bus, uint8_t reg,
+			 const uint8_t *data, uint32_t len)
+{
+	bme68x_iaq_bus_release(bus);
+	return transfer(bus, reg, (uint8_t *)data, len, false);
+}
+
+int bme68x_iaq_bus_read(struct bme68x_iaq_bus *bus, uint8_t reg, uint8_t *data, uint32_t len)
+{
+	if (shadow_has(bus, reg, len)) {
+		memcpy(data, &bus->shadow[reg - BME68X_IAQ_BUS_SHADOW_START], len);
+		return 0;
+	}
+	return transfer(bus, reg, data, len, true);
+}
+
+#else /* CONFIG_BME68X_IAQ_RTIO */
+
+int bme68x_iaq_bus_write(struct bme68x_iaq_bus *bus, uint8_t reg,
+			 const uint8_t *data, uint32_t len)
+{
+	/* register address and payload go out as one transfer, without a copy */
+	struct i2c_msg msgs[2] = {
+		{
+			.buf = &reg,
+			.len = sizeof(reg),
+			.flags = I2C_MSG_WRITE,
+		},
+		{
+			.buf = (uint8_t *)data,
+			.len = len,
+			.flags = I2C_MSG_WRITE | I2C_MSG_STOP,
+		},
+	};
+
+	bus->transactions++;
+	bus->submissions++;
+	return i2c_transfer_dt(bus->i2c, msgs, ARRAY_SIZE(msgs));
+}
+
+int bme68x_iaq_bus_read(struct bme68x_iaq_bus *bus, uint8_t reg, uint8_t *data, uint32_t len)
+{
+	bus->transactions++;
+	bus->submissions++;
+	return i2c_write_read_dt(bus->i2c, &reg, sizeof(reg), data, len);
+}
+
+#endif /* CONFIG_BME68X_IAQ_RTIO */
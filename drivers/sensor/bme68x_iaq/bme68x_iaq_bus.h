@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2023 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/* I2C transport of the bme68x register accesses */
+
+#ifndef ZEPHYR_DRIVERS_SENSOR_BME68X_IAQ_BUS
+#define ZEPHYR_DRIVERS_SENSOR_BME68X_IAQ_BUS
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <zephyr/drivers/i2c.h>
+#if CONFIG_BME68X_IAQ_RTIO
+#include <zephyr/rtio/rtio.h>
+#endif
+
+#include "bme68x_defs.h"
+
+/* Registers read by bme68x_get_data(): the three measurement fields, then
+ * the heater current, resistance and wait time of the ten heater profiles
+ */
+#define BME68X_IAQ_BUS_SHADOW_START BME68X_REG_FIELD0
+#define BME68X_IAQ_BUS_SHADOW_LEN (BME68X_REG_GAS_WAIT0 + 10 - BME68X_REG_FIELD0)
+
+struct bme68x_iaq_bus {
+	const struct i2c_dt_spec *i2c;
+#if CONFIG_BME68X_IAQ_RTIO
+	/* Context and device the transactions are queued on */
+	struct rtio *rtio;
+	struct rtio_iodev *iodev;
+
+	/* Registers read ahead by bme68x_iaq_bus_prefetch(), and which of
+	 * them are valid
+	 */
+	uint8_t shadow[BME68X_IAQ_BUS_SHADOW_LEN];
+	bool shadow_valid[BME68X_IAQ_BUS_SHADOW_LEN];
+#endif
+	/* Transactions on the bus, and submissions the caller waited for */
+	uint32_t transactions;
+	uint32_t submissions;
+};
+
+/* Write registers, the payload is sent after the register address without
+ * being copied
+ */
+int bme68x_iaq_bus_write(struct bme68x_iaq_bus *bus, uint8_t reg,
+			 const uint8_t *data, uint32_t len);
+
+/* Read registers, from the registers read ahead if they all are */
+int bme68x_iaq_bus_read(struct bme68x_iaq_bus *bus, uint8_t reg, uint8_t *data, uint32_t len);
+
+#if CONFIG_BME68X_IAQ_RTIO
+/* Read ahead, in one submission, the registers bme68x_get_data() reads in
+ * op_mode, so that it does not wait for the bus once per register block.
+ * The registers stay valid until bme68x_iaq_bus_release() or a write.
+ */
+int bme68x_iaq_bus_prefetch(struct bme68x_iaq_bus *bus, uint8_t op_mode);
+
+/* Forget the registers read ahead, the device updates them */
+void bme68x_iaq_bus_release(struct bme68x_iaq_bus *bus);
+#else
+static inline int bme68x_iaq_bus_prefetch(struct bme68x_iaq_bus *bus, uint8_t op_mode)
+{
+	ARG_UNUSED(bus);
+	ARG_UNUSED(op_mode);
+	return 0;
+}
+
+static inline void bme68x_iaq_bus_release(struct bme68x_iaq_bus *bus)
+{
+	ARG_UNUSED(bus);
+}
+#endif
+
+#endif /* ZEPHYR_DRIVERS_SENSOR_BME68X_IAQ_BUS */
@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2023 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/* Publication of the BSEC outputs to readers in other threads */
+
+#ifndef ZEPHYR_DRIVERS_SENSOR_BME68X_IAQ_OUTPUT
+#define ZEPHYR_DRIVERS_SENSOR_BME68X_IAQ_OUTPUT
+
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/barrier.h>
+#include <drivers/bme68x_iaq_ext.h>
+
+/* Run by a reader between copying a sample and checking that it was not
+ * replaced meanwhile, lets the tests publish at that point.
+ */
+#ifndef BME68X_IAQ_OUTPUT_READ_HOOK
+#define BME68X_IAQ_OUTPUT_READ_HOOK()
+#endif
+
+struct bme68x_iaq_output {
+	/* Published samples, latest[generation & 1] holds the most recent one */
+	struct bme_sample_result latest[2];
+
+	/* Incremented each time a new sample is published, 0 until the first one */
+	atomic_t generation;
+};
+
+/* Publish a sample without blocking readers.
+ * There must be a single writer, so the buffer that is not selected by the
+ * current generation can be overwritten while readers copy the other one.
+ */
+static inline void bme68x_iaq_output_publish(struct bme68x_iaq_output *output,
+					     const struct bme_sample_result *sample)
+{
+	atomic_val_t next = atomic_get(&output->generation) + 1;
+
+	output->latest[next & 1] = *sample;
+	/* the sample must be complete before the generation pointing at it is visible */
+	barrier_dmem_fence_full();
+	atomic_set(&output->generation, next);
+}
+
+/* Copy a consistent snapshot of the most recently published sample.
+ * The copy is retried if a new sample was published meanwhile, since the
+ * buffer being copied may have been reused by the writer.
+ */
+static inline void bme68x_iaq_output_read(struct bme68x_iaq_output *output,
+					  struct bme_sample_result *out)
+{
+	atomic_val_t generation;
+
+	do {
+		generation = atomic_get(&output->generation);
+		*out = output->latest[generation & 1];
+		BME68X_IAQ_OUTPUT_READ_HOOK();
+		barrier_dmem_fence_full();
+	} while (generation != atomic_get(&output->generation));
+}
+
+/* Whether a sample was published */
+static inline bool bme68x_iaq_output_available(struct bme68x_iaq_output *output)
+{
+	return atomic_get(&output->generation) != 0;
+}
+
+#endif /* ZEPHYR_DRIVERS_SENSOR_BME68X_IAQ_OUTPUT */
@@ -0,0 +1,51 @@
+/*
+ * Copyright (c) 2023 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/sys/crc.h>
+
+#include "bme68x_iaq_state.h"
+
+const char *bme68x_iaq_slot_name(uint32_t generation)
+{
+	return (generation & 1) ? "1" : "0";
+}
+
+size_t bme68x_iaq_slot_build(uint8_t *buf, uint32_t generation,
+			     const uint8_t *state, size_t state_len)
+{
+	struct bme68x_iaq_slot_header header = {
+		.magic = BME68X_IAQ_SLOT_MAGIC,
+		.generation = generation,
+		.len = state_len,
+		.crc = crc32_ieee(state, state_len),
+	};
+
+	memcpy(buf, &header, sizeof(header));
+	memcpy(buf + sizeof(header), state, state_len);
+	return sizeof(header) + state_len;
+}
+
+int bme68x_iaq_slot_check(const uint8_t *buf, size_t len, uint32_t generation,
+			  struct bme68x_iaq_slot_header *header)
+{
+	if (len < sizeof(*header)) {
+		return -EBADMSG;
+	}
+
+	memcpy(header, buf, sizeof(*header));
+	if (header->magic != BME68X_IAQ_SLOT_MAGIC || header->len != len - sizeof(*header) ||
+	    header->len == 0 || header->crc != crc32_ieee(buf + sizeof(*header), header->len)) {
+		return -EBADMSG;
+	}
+
+	/* the backend may report older values of a slot, keep the newest */
+	if (header->generation <= generation) {
+		return 0;
+	}
+	return header->len;
+}
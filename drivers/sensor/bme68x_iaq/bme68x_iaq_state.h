@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2023 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/* Slots holding the saved BSEC state */
+
+#ifndef ZEPHYR_DRIVERS_SENSOR_BME68X_IAQ_STATE
+#define ZEPHYR_DRIVERS_SENSOR_BME68X_IAQ_STATE
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* The state alternates between two slots, bsec/state/0 and bsec/state/1,
+ * so a torn write only loses the slot being written. bsec/state itself
+ * holds a state without header, as saved by older firmware.
+ */
+#define BME68X_IAQ_SLOT_MAGIC 0x42534543 /* "BSEC" */
+
+struct bme68x_iaq_slot_header {
+	uint32_t magic;
+	uint32_t generation;
+	uint32_t len;
+	uint32_t crc;
+};
+
+/* Name of the slot, under the state key, written with the given generation */
+const char *bme68x_iaq_slot_name(uint32_t generation);
+
+/* Build in buf the slot holding state at the given generation. buf must hold
+ * the header and the state. Returns the size of the slot.
+ */
+size_t bme68x_iaq_slot_build(uint8_t *buf, uint32_t generation,
+			     const uint8_t *state, size_t state_len);
+
+/* Check a slot read back from the settings, for a state loaded so far at
+ * the given generation, 0 if none was.
+ * Returns the length of the state, which follows the header in buf, if the
+ * slot holds a newer state, 0 if it holds an older one and -EBADMSG if it is
+ * torn, corrupted or not a slot.
+ */
+int bme68x_iaq_slot_check(const uint8_t *buf, size_t len, uint32_t generation,
+			  struct bme68x_iaq_slot_header *header);
+
+#endif /* ZEPHYR_DRIVERS_SENSOR_BME68X_IAQ_STATE */
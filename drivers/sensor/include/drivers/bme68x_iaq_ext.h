@@ -0,0 +1,179 @@
+/*
+ * Copyright (c) 2025 Grovety Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* Extended API of the BME68x IAQ driver */
+
+#ifndef BME68X_IAQ_EXT_H_
+#define BME68X_IAQ_EXT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/sensor.h>
+#include <drivers/bme68x_iaq.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** BSEC sample modes, selected with SENSOR_ATTR_BME68X_IAQ_SAMPLE_RATE. */
+enum bme68x_iaq_sample_rate {
+	/** All outputs every 300 seconds. */
+	BME68X_IAQ_SAMPLE_RATE_ULTRA_LOW_POWER,
+	/** All outputs every 3 seconds. */
+	BME68X_IAQ_SAMPLE_RATE_LOW_POWER,
+	/** All outputs every second, for testing only. */
+	BME68X_IAQ_SAMPLE_RATE_CONTINUOUS,
+	/** Gas outputs every 300 seconds, temperature, pressure and humidity every 3 seconds. */
+	BME68X_IAQ_SAMPLE_RATE_QUICK_ULTRA_LOW_POWER,
+};
+
+/**
+ * Sensor attribute of SENSOR_CHAN_ALL selecting the BSEC sample mode.
+ *
+ * val1 holds a value of enum bme68x_iaq_sample_rate. The selected mode is
+ * stored with the settings subsystem and restored on the next boot.
+ * sensor_attr_get() returns the stored mode, even while a mode selected with
+ * SENSOR_ATTR_BME68X_IAQ_SAMPLE_RATE_RUNTIME is in use.
+ */
+#define SENSOR_ATTR_BME68X_IAQ_SAMPLE_RATE (SENSOR_ATTR_PRIV_START)
+
+/**
+ * Sensor attribute of SENSOR_CHAN_ALL selecting the BSEC sample mode until
+ * the next reset.
+ *
+ * Same as SENSOR_ATTR_BME68X_IAQ_SAMPLE_RATE, but the mode is not stored.
+ * Meant for modes changed often, by a power policy for instance.
+ * sensor_attr_get() returns the mode in use.
+ */
+#define SENSOR_ATTR_BME68X_IAQ_SAMPLE_RATE_RUNTIME (SENSOR_ATTR_PRIV_START + 1)
+
+/** All outputs produced by a single BSEC step. */
+struct bme_sample_result {
+	/** Heat compensated temperature in degrees Celsius. */
+	float temperature;
+	/** Heat compensated relative humidity in percent. */
+	float humidity;
+	/** Pressure in Pascals. */
+	float pressure;
+	/** Index for air quality, 0 to 500. */
+	uint16_t air_quality;
+
+	/** CO2 equivalent in ppm. */
+	float co2;
+	/** Breath VOC equivalent in ppm. */
+	float voc;
+
+	enum bme68x_accuracy iaq_accuracy;
+	enum bme68x_accuracy co2_accuracy;
+	enum bme68x_accuracy voc_accuracy;
+
+	bool gas_run_in_status;
+	bool gas_stabilizasion_status;
+
+	/** System uptime in milliseconds at which the sample was measured. */
+	int64_t timestamp_ms;
+};
+
+/**
+ * @brief Get the latest BSEC outputs in one call.
+ *
+ * The snapshot is taken without blocking the BSEC work and all fields
+ * belong to the same BSEC step.
+ *
+ * Until BSEC produces its first output after a reset, the outputs saved
+ * with the BSEC state before the reset are provided, with a timestamp_ms
+ * of 0.
+ *
+ * @param dev BME68x IAQ device.
+ * @param out Storage for the snapshot.
+ *
+ * @retval 0 on success.
+ * @retval -ENODATA if BSEC has not produced any output yet and none were
+ *  saved.
+ */
+int bme68x_iaq_get_snapshot(const struct device *dev, struct bme_sample_result *out);
+
+/** Magic value of an exported BSEC state, "BSEC" */
+#define BME68X_IAQ_STATE_MAGIC 0x42534543
+/** Version of the exported state format */
+#define BME68X_IAQ_STATE_VERSION 1
+/** Largest BSEC state blob */
+#define BME68X_IAQ_STATE_BLOB_MAX 256
+
+/** Header of an exported BSEC state, little endian. The BSEC state blob follows. */
+struct bme68x_iaq_state_header {
+	/** BME68X_IAQ_STATE_MAGIC. */
+	uint32_t magic;
+	/** BME68X_IAQ_STATE_VERSION. */
+	uint16_t version;
+	/** Length of the blob. */
+	uint16_t len;
+	/** CRC32 (IEEE) of the blob. */
+	uint32_t crc;
+} __packed;
+
+/** Largest exported BSEC state */
+#define BME68X_IAQ_STATE_EXPORT_MAX \
+	(sizeof(struct bme68x_iaq_state_header) + BME68X_IAQ_STATE_BLOB_MAX)
+
+/**
+ * @brief Save the BSEC state to flash now.
+ *
+ * The state is also saved every CONFIG_BME68X_IAQ_SAVE_INTERVAL_MINUTES.
+ * Call this before a reset or when the battery is about to run out, so the
+ * calibration since the last periodic save is kept. Nothing is written if
+ * the state did not change since it was last saved.
+ *
+ * The state is saved by the BSEC work, so this blocks until it is done.
+ *
+ * @param dev BME68x IAQ device.
+ *
+ * @retval 0 on success.
+ * @retval -EAGAIN if the BSEC work did not take the request in time.
+ * @retval other negative error code if saving failed.
+ */
+int bme68x_iaq_save_state(const struct device *dev);
+
+/**
+ * @brief Export the BSEC calibration state, to clone it to another sensor.
+ *
+ * The state is taken by the BSEC work, so this blocks until it is done.
+ *
+ * @param dev BME68x IAQ device.
+ * @param buf Storage for the state, a header followed by the BSEC blob.
+ * @param size Size of the storage, BME68X_IAQ_STATE_EXPORT_MAX is enough.
+ *
+ * @return Length of the exported state on success, negative error code
+ *  on failure.
+ */
+int bme68x_iaq_export_state(const struct device *dev, uint8_t *buf, size_t size);
+
+/**
+ * @brief Import a BSEC calibration state exported by another sensor, and
+ *  save it to flash.
+ *
+ * The sensors must run the same BSEC version and configuration.
+ *
+ * @param dev BME68x IAQ device.
+ * @param buf State, as provided by bme68x_iaq_export_state().
+ * @param len Length of the state.
+ *
+ * @retval 0 on success.
+ * @retval -EINVAL if the state is malformed.
+ * @retval -ENOTSUP if the state format version is not supported.
+ * @retval -EBADMSG if the state fails its CRC.
+ * @retval -EIO if BSEC refused the state.
+ * @retval other negative error code if saving failed.
+ */
+int bme68x_iaq_import_state(const struct device *dev, const uint8_t *buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BME68X_IAQ_EXT_H_ */
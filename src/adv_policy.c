@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2025 Grovety Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "adv_policy.h"
+
+void adv_policy_init(struct adv_policy *policy, const struct adv_policy_config *config)
+{
+	memset(policy, 0, sizeof(*policy));
+	policy->config = config;
+}
+
+static bool changed_significantly(const struct adv_policy *policy, const struct adv_input *input)
+{
+	const struct adv_policy_config *cfg = policy->config;
+	const struct adv_input *ref = &policy->reference;
+
+	return fabsf(input->co2 - ref->co2) >= cfg->co2_delta_ppm ||
+		   fabsf(input->iaq - ref->iaq) >= cfg->iaq_delta ||
+		   fabsf(input->temperature - ref->temperature) >= cfg->temperature_delta ||
+		   fabsf(input->humidity - ref->humidity) >= cfg->humidity_delta;
+}
+
+enum adv_mode adv_policy_update(struct adv_policy *policy, const struct adv_input *input)
+{
+	const struct adv_policy_config *cfg = policy->config;
+	bool burst = false;
+
+	if (!policy->has_reference)
+	{
+		policy->reference = *input;
+		policy->last_change_ms = input->timestamp_ms;
+		policy->has_reference = true;
+	}
+	else if (changed_significantly(policy, input))
+	{
+		/* Compare against the last significant reading rather than the
+		 * previous one, so slow drifts are reported too.
+		 */
+		policy->reference = *input;
+		policy->last_change_ms = input->timestamp_ms;
+		burst = true;
+	}
+
+	if (!policy->co2_alarm && input->co2 >= cfg->co2_alarm_ppm)
+	{
+		policy->co2_alarm = true;
+		burst = true;
+	}
+	else if (policy->co2_alarm && input->co2 < cfg->co2_alarm_ppm - cfg->co2_delta_ppm)
+	{
+		policy->co2_alarm = false;
+	}
+
+	if (burst)
+	{
+		policy->burst_until_ms = input->timestamp_ms + cfg->burst_ms;
+	}
+
+	if (input->timestamp_ms < policy->burst_until_ms)
+	{
+		return ADV_MODE_BURST;
+	}
+	if (input->timestamp_ms - policy->last_change_ms >= cfg->stable_ms)
+	{
+		return ADV_MODE_STABLE;
+	}
+	return ADV_MODE_NORMAL;
+}
@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2025 Grovety Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief Advertising modes selected by the policy.
+     */
+    enum adv_mode
+    {
+        /** A value changed significantly or an alarm was raised, advertise fast. */
+        ADV_MODE_BURST,
+        /** Regular operation. */
+        ADV_MODE_NORMAL,
+        /** Values have been stable for a while, advertise slowly. */
+        ADV_MODE_STABLE,
+    };
+
+    /**
+     * @brief Thresholds of the advertising policy.
+     */
+    struct adv_policy_config
+    {
+        /** CO2 level that raises the alarm, in ppm. */
+        float co2_alarm_ppm;
+        /** Significant CO2 change, in ppm. Also the alarm hysteresis. */
+        float co2_delta_ppm;
+        /** Significant IAQ change. */
+        float iaq_delta;
+        /** Significant temperature change, in degrees Celsius. */
+        float temperature_delta;
+        /** Significant humidity change, in percentage. */
+        float humidity_delta;
+        /** Duration of ADV_MODE_BURST, in milliseconds. */
+        uint32_t burst_ms;
+        /** Time without significant change before ADV_MODE_STABLE, in milliseconds. */
+        uint32_t stable_ms;
+    };
+
+    /**
+     * @brief Inputs of one policy step.
+     */
+    struct adv_input
+    {
+        /** Time of the readings, in milliseconds. */
+        int64_t timestamp_ms;
+        /** Temperature, in degrees Celsius. */
+        float temperature;
+        /** Relative humidity, in percentage. */
+        float humidity;
+        /** CO2 concentration, in ppm. */
+        float co2;
+        /** Index for air quality. */
+        float iaq;
+    };
+
+    /**
+     * @brief State of the advertising policy. Fields are private.
+     */
+    struct adv_policy
+    {
+        const struct adv_policy_config *config;
+        int64_t burst_until_ms;
+        int64_t last_change_ms;
+        struct adv_input reference;
+        bool has_reference;
+        bool co2_alarm;
+    };
+
+    /**
+     * @brief Initializes the policy.
+     *
+     * @param policy Policy to initialize.
+     * @param config Thresholds, must stay valid while the policy is used.
+     */
+    void adv_policy_init(struct adv_policy *policy, const struct adv_policy_config *config);
+
+    /**
+     * @brief Feeds new readings to the policy.
+     *
+     * A value moving by more than its delta from the last significant reading,
+     * or CO2 crossing the alarm level, selects ADV_MODE_BURST for burst_ms.
+     * ADV_MODE_STABLE is selected once no value changed significantly for
+     * stable_ms.
+     *
+     * @param policy Policy to update.
+     * @param input Latest readings.
+     *
+     * @return Advertising mode to use.
+     */
+    enum adv_mode adv_policy_update(struct adv_policy *policy, const struct adv_input *input);
+
+#ifdef __cplusplus
+}
+#endif
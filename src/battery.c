@@ -138,6 +138,18 @@ static int divider_setup(void)
 		accp->input_positive = SAADC_CH_PSELP_PSELP_VDD;
 	}
 
+	asp->resolution = 14;
+#elif CONFIG_ADC_EMUL
+	/* Emulated ADC of the native_sim tests */
+	*accp = (struct adc_channel_cfg){
+		.gain = ADC_GAIN_1,
+		.reference = ADC_REF_INTERNAL,
+		.acquisition_time = ADC_ACQ_TIME_DEFAULT,
+		.channel_id = iocp->channel,
+	};
+
+	asp->channels = BIT(iocp->channel);
+	asp->oversampling = 0;
 	asp->resolution = 14;
 #else /* CONFIG_ADC_var */
 #error Unsupported ADC
@@ -179,6 +191,66 @@ int battery_measure_enable(bool enable)
 	return rc;
 }
 
+/* Signal raised by the ADC driver when an asynchronous read completes */
+static struct k_poll_signal adc_signal = K_POLL_SIGNAL_INITIALIZER(adc_signal);
+
+/* Maximum time to wait for one conversion */
+#define BATTERY_ADC_TIMEOUT K_MSEC(100)
+
+/* Set when a conversion timed out. The SAADC read cannot be cancelled: it
+ * still writes ddp->raw and the ADC stays locked until it completes, so the
+ * divider is left powered and no read is started before it has signalled.
+ */
+static bool adc_pending;
+
+/* Run one conversion, sleeping until the ADC signals completion */
+static int battery_adc_read(struct divider_data *ddp)
+{
+	struct k_poll_event event = K_POLL_EVENT_INITIALIZER(K_POLL_TYPE_SIGNAL,
+														 K_POLL_MODE_NOTIFY_ONLY,
+														 &adc_signal);
+	unsigned int signaled;
+	int result;
+	int rc;
+
+	k_poll_signal_reset(&adc_signal);
+	rc = adc_read_async(ddp->adc, &ddp->adc_seq, &adc_signal);
+	if (rc != 0)
+	{
+		return rc;
+	}
+
+	rc = k_poll(&event, 1, BATTERY_ADC_TIMEOUT);
+	if (rc != 0)
+	{
+		LOG_WRN("ADC read timed out, finishing it on the next sample");
+		adc_pending = true;
+		return -ETIMEDOUT;
+	}
+
+	k_poll_signal_check(&adc_signal, &signaled, &result);
+	return result;
+}
+
+/* Whether the conversion that timed out still runs */
+static bool battery_adc_busy(void)
+{
+	unsigned int signaled;
+	int result;
+
+	if (adc_pending)
+	{
+		k_poll_signal_check(&adc_signal, &signaled, &result);
+		if (!signaled)
+		{
+			return true;
+		}
+		/* Its result is not used, the sample is taken again */
+		adc_pending = false;
+	}
+	return false;
+}
+
 int battery_sample(void)
 {
 	int rc = -ENOENT;
@@ -188,12 +260,47 @@ int battery_sample(void)
 		struct divider_data *ddp = &divider_data;
 		const struct divider_config *dcp = &divider_config;
 		struct adc_sequence *sp = &ddp->adc_seq;
+		bool powered = adc_pending;
+		int32_t sum = 0;
+
+		if (battery_adc_busy())
+		{
+			return -EBUSY;
+		}
+
+		/* The divider only draws current while it is powered, it still
+		 * is if the previous conversion timed out
+		 */
+		if (!powered)
+		{
+			rc = battery_measure_enable(true);
+			if (rc != 0)
+			{
+				return rc;
+			}
+			if (dcp->power_gpios.port)
+			{
+				k_sleep(K_USEC(CONFIG_APP_BATTERY_SETTLE_TIME_US));
+			}
+		}
+		rc = 0;
+
+		for (int i = 0; (rc == 0) && (i < CONFIG_APP_BATTERY_SAMPLE_COUNT); ++i)
+		{
+			rc = battery_adc_read(ddp);
+			sp->calibrate = false;
+			sum += ddp->raw;
+		}
+
+		if (!adc_pending)
+		{
+			battery_measure_enable(false);
+		}
 
-		rc = adc_read(ddp->adc, sp);
-		sp->calibrate = false;
 		if (rc == 0)
 		{
-			int32_t val = ddp->raw;
+			int32_t raw = sum / CONFIG_APP_BATTERY_SAMPLE_COUNT;
+			int32_t val = raw;
 
 			adc_raw_to_millivolts(adc_ref_internal(ddp->adc),
 								  ddp->adc_cfg.gain,
@@ -203,13 +310,13 @@ int battery_sample(void)
 			if (dcp->output_ohm != 0)
 			{
 				rc = val * (uint64_t)dcp->full_ohm / dcp->output_ohm;
-				LOG_INF("raw %u ~ %u mV => %d mV\n",
-						ddp->raw, val, rc);
+				LOG_INF("raw %d ~ %d mV => %d mV\n",
+						raw, val, rc);
 			}
 			else
 			{
 				rc = val;
-				LOG_INF("raw %u ~ %u mV\n", ddp->raw, val);
+				LOG_INF("raw %d ~ %d mV\n", raw, val);
 			}
 		}
 	}
@@ -243,3 +350,89 @@ unsigned int battery_level_pptt(unsigned int batt_mV,
 
 	return pb->lvl_pptt + ((pa->lvl_pptt - pb->lvl_pptt) * (batt_mV - pb->lvl_mV) / (pa->lvl_mV - pb->lvl_mV));
 }
+
+/* Weight of a new sample in the battery voltage filter is 1/BATTERY_FILTER_DIV */
+#define BATTERY_FILTER_DIV 4
+
+#if CONFIG_APP_BATTERY_AAA
+/* Two alkaline AAA cells in series at low current */
+static const struct battery_level_point discharge_curve[] = {
+	{10000, 3100},
+	{8000, 2700},
+	{6000, 2550},
+	{4000, 2400},
+	{2000, 2250},
+	{500, 2100},
+	{0, 2000},
+};
+#else
+/* CR2032 lithium coin cell at low current */
+static const struct battery_level_point discharge_curve[] = {
+	{10000, 3000},
+	{8000, 2900},
+	{6000, 2850},
+	{4000, 2800},
+	{2000, 2700},
+	{500, 2500},
+	{0, 2000},
+};
+#endif
+
+static atomic_t battery_mV = ATOMIC_INIT(-ENODATA);
+static atomic_t battery_pptt = ATOMIC_INIT(-ENODATA);
+
+static void battery_update(void)
+{
+	int sample = battery_sample();
+
+	if (sample < 0)
+	{
+		LOG_WRN("Battery sample failed: %d", sample);
+		return;
+	}
+
+	int filtered = atomic_get(&battery_mV);
+
+	if (filtered < 0)
+	{
+		filtered = sample;
+	}
+	else
+	{
+		filtered += (sample - filtered) / BATTERY_FILTER_DIV;
+	}
+
+	atomic_set(&battery_pptt, battery_level_pptt(filtered, discharge_curve));
+	atomic_set(&battery_mV, filtered);
+}
+
+static void battery_work_handler(struct k_work *work)
+{
+	battery_update();
+	k_work_schedule(k_work_delayable_from_work(work),
+					K_SECONDS(CONFIG_APP_BATTERY_SAMPLE_INTERVAL_SEC));
+}
+
+static K_WORK_DELAYABLE_DEFINE(battery_work, battery_work_handler);
+
+int battery_service_start(void)
+{
+	if (!battery_ok)
+	{
+		return -ENOENT;
+	}
+
+	battery_update();
+	k_work_schedule(&battery_work, K_SECONDS(CONFIG_APP_BATTERY_SAMPLE_INTERVAL_SEC));
+	return 0;
+}
+
+int battery_get_mV(void)
+{
+	return atomic_get(&battery_mV);
+}
+
+int battery_get_pptt(void)
+{
+	return atomic_get(&battery_pptt);
+}
@@ -21,6 +21,14 @@ extern "C"
 	int battery_measure_enable(bool enable);
 
 	/** Measure the battery voltage.
+	 *
+	 * The divider is powered only for the duration of the measurement,
+	 * which averages CONFIG_APP_BATTERY_SAMPLE_COUNT conversions.  The
+	 * calling thread sleeps while the ADC converts.
+	 *
+	 * A conversion that times out cannot be cancelled. The divider then
+	 * stays powered, and later calls return -EBUSY without waiting until
+	 * it has completed.
 	 *
 	 * @return the battery voltage in millivolts, or a negative error
 	 * code.
@@ -56,6 +64,34 @@ extern "C"
 	unsigned int battery_level_pptt(unsigned int batt_mV,
 									const struct battery_level_point *curve);
 
+	/** Start the battery service.
+	 *
+	 * A first sample is taken synchronously, then the voltage is sampled
+	 * every CONFIG_APP_BATTERY_SAMPLE_INTERVAL_SEC seconds.  Samples are
+	 * low-pass filtered and cached, so battery_get_mV() and
+	 * battery_get_pptt() never access the ADC.
+	 *
+	 * @return zero on success, or a negative error code.
+	 */
+	int battery_service_start(void);
+
+	/** Get the filtered battery voltage.
+	 *
+	 * @return the battery voltage in millivolts, or a negative error
+	 * code if no sample is available.
+	 */
+	int battery_get_mV(void);
+
+	/** Get the estimated battery level.
+	 *
+	 * The filtered voltage is converted with the discharge curve of the
+	 * battery selected in Kconfig.
+	 *
+	 * @return the estimated remaining capacity in parts per ten
+	 * thousand, or a negative error code if no sample is available.
+	 */
+	int battery_get_pptt(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -5,32 +5,29 @@
  */
 
 #include <zephyr/types.h>
+#include <zephyr/kernel.h>
 #include <zephyr/bluetooth/uuid.h>
 #include <zephyr/bluetooth/conn.h>
 #include <zephyr/bluetooth/gatt.h>
 #include <zephyr/bluetooth/services/bas.h>
 #include <zephyr/settings/settings.h>
+#include <zephyr/sys/byteorder.h>
 #include <hw_id.h>
 #include <math.h>
 
 #include "ble.h"
+#include "ble_notify.h"
+#include "bthome.h"
+#include "conn_policy.h"
+#include "ess_trigger.h"
+#if CONFIG_APP_BT_EXT_ADV
+#include "ble_ext_adv.h"
+#endif
 
 #include <zephyr/logging/log.h>
 
 LOG_MODULE_DECLARE(app, CONFIG_APP_LOG_LEVEL);
 
-#define SERVICE_DATA_LEN 18
-#define SERVICE_UUID 0xfcd2 /* BTHome service UUID */
-#define IDX_BATT 4			/* Index of battery data in service data*/
-#define IDX_TEMPL 6			/* Index of lo byte of temp in service data*/
-#define IDX_TEMPH 7			/* Index of hi byte of temp in service data*/
-#define IDX_HUML 9			/* Index of lo byte of humidity in service data*/
-#define IDX_HUMH 10			/* Index of hi byte of humidity in service data*/
-#define IDX_PRESSUREL 12	/* Index of lo byte of pressure in service data*/
-#define IDX_PRESSUREH 14	/* Index of hi byte of pressure in service data*/
-#define IDX_CO2L 16			/* Index of lo byte of co2 in service data*/
-#define IDX_CO2H 17			/* Index of hi byte of co2 in service data*/
-
 static int16_t last_temp = 0;
 static uint16_t last_humidity = 0;
 static uint32_t last_pressure = 0;
@@ -38,141 +35,543 @@ static uint16_t last_voc = 0;
 static uint16_t last_co2 = 0;
 static uint16_t last_iaq = 0;
 static uint8_t last_batt = 0;
-static uint8_t service_data[SERVICE_DATA_LEN] = {
-	BT_UUID_16_ENCODE(SERVICE_UUID),
-	0x40,
-	0x01, /* Battery */
-	0x00,
-	0x02, /* Temperature */
-	0x00, /* Low byte */
-	0x00, /* High byte */
-	0x03, /* Humidity */
-	0x00, /* Low byte */
-	0x00, /* High byte */
-	0x04, /* Pressure */
-	0x00, /* Low byte */
-	0x00,
-	0x00, /* High byte */
-	0x12, /* CO2 */
-	0x00, /* Low byte */
-	0x00, /* High byte */
-};
+
+/* Sensor record, all channels in one notification. Kept within the
+ * 20 bytes a notification carries with the default ATT MTU.
+ */
+struct sensor_record
+{
+	uint8_t seq;
+	/* Uptime, in seconds */
+	uint32_t timestamp;
+	/* 0.01 degrees Celsius */
+	int16_t temperature;
+	/* 0.01 % */
+	uint16_t humidity;
+	/* Pa, 24 bit */
+	uint8_t pressure[3];
+	/* ppm */
+	uint16_t co2;
+	/* ppb */
+	uint16_t voc;
+	uint16_t iaq;
+	/* % */
+	uint8_t battery;
+	/* SENSOR_RECORD_STATUS_* */
+	uint8_t status;
+} __packed;
+
+BUILD_ASSERT(sizeof(struct sensor_record) <= BT_ATT_DEFAULT_LE_MTU - 3);
+
+#define SENSOR_RECORD_STATUS_IAQ_ACC(x) ((x) & 0x03)
+#define SENSOR_RECORD_STATUS_CO2_ACC(x) (((x) & 0x03) << 2)
+#define SENSOR_RECORD_STATUS_VOC_ACC(x) (((x) & 0x03) << 4)
+#define SENSOR_RECORD_STATUS_RUN_IN BIT(6)
+#define SENSOR_RECORD_STATUS_STABILIZED BIT(7)
+
+static uint8_t last_status = 0;
+static struct sensor_record record;
 
 static char unique_name[sizeof(CONFIG_BT_DEVICE_NAME) + HW_ID_LEN];
 
+/* Advertised part of the name: the prefix and 3 characters of the hardware ID */
+#define ADV_NAME_LEN 6
+
+/* Typical VOC mixture, 110 g/mol at 25 degrees Celsius */
+#define TVOC_UG_M3_PER_PPB 4.5f
+
+/* BTHome objects, in ascending object ID order */
+enum adv_object
+{
+	ADV_BATTERY,
+	ADV_TEMPERATURE,
+	ADV_HUMIDITY,
+	ADV_PRESSURE,
+	ADV_IAQ_ACCURACY,
+	ADV_STABILIZED,
+	ADV_CO2,
+	ADV_TVOC,
+	ADV_IAQ,
+	ADV_OBJECT_COUNT,
+};
+
+static struct bthome_object adv_objects[ADV_OBJECT_COUNT] = {
+	[ADV_BATTERY] = {BTHOME_ID_BATTERY},
+	[ADV_TEMPERATURE] = {BTHOME_ID_TEMPERATURE},
+	[ADV_HUMIDITY] = {BTHOME_ID_HUMIDITY},
+	[ADV_PRESSURE] = {BTHOME_ID_PRESSURE},
+	[ADV_IAQ_ACCURACY] = {BTHOME_ID_COUNT_U8},
+	[ADV_STABILIZED] = {BTHOME_ID_BOOLEAN},
+	[ADV_CO2] = {BTHOME_ID_CO2},
+	[ADV_TVOC] = {BTHOME_ID_TVOC},
+	[ADV_IAQ] = {BTHOME_ID_COUNT_U16},
+};
+
+/* Objects of the legacy advertising. Every object does not fit in one
+ * BTHome frame next to the flags, and receivers merge or drop a second frame
+ * with the same packet ID, so the IAQ accuracy and the stabilization flag are
+ * only in the extended advertising and the sensor record.
+ */
+static const uint8_t adv_legacy_objects[] = {
+	ADV_BATTERY, ADV_TEMPERATURE, ADV_HUMIDITY, ADV_PRESSURE, ADV_CO2, ADV_TVOC, ADV_IAQ,
+};
+
+/* Service data budget: the legacy 31 bytes minus the flags and the service
+ * data AD header
+ */
+static uint8_t adv_service_data[BT_GAP_ADV_MAX_ADV_DATA_LEN - 3 - 2];
+static uint8_t packet_id = 0;
+
 static struct bt_data ad[] = {
 	BT_DATA_BYTES(BT_DATA_FLAGS, BT_LE_AD_GENERAL | BT_LE_AD_NO_BREDR),
-	BT_DATA(BT_DATA_NAME_COMPLETE, unique_name, 6),
-	BT_DATA(BT_DATA_SVC_DATA16, service_data, ARRAY_SIZE(service_data))};
+	BT_DATA(BT_DATA_SVC_DATA16, adv_service_data, 0)};
+
+static struct bt_data sd[] = {
+	BT_DATA(BT_DATA_NAME_COMPLETE, unique_name, ADV_NAME_LEN)};
+
+#if CONFIG_APP_BT_EXT_ADV
+/* Extended advertising has no 31 byte limit, every object fits in one frame */
+static uint8_t ext_service_data[BTHOME_HEADER_LEN + ADV_OBJECT_COUNT * 4 + 2];
+/* EnSens service UUID followed by the sensor record */
+static uint8_t ext_record_data[BT_UUID_SIZE_128 + sizeof(struct sensor_record)];
+
+/* Both payloads exceed the legacy 31 bytes, the controller must take them */
+#define EXT_AD_LEN ((2 + ADV_NAME_LEN) + (2 + sizeof(ext_service_data)))
+#define PER_AD_LEN ((2 + sizeof(ext_service_data)) + (2 + sizeof(ext_record_data)))
+#if defined(CONFIG_BT_CTLR_ADV_DATA_LEN_MAX)
+BUILD_ASSERT(EXT_AD_LEN <= CONFIG_BT_CTLR_ADV_DATA_LEN_MAX,
+			 "Extended advertising data exceeds CONFIG_BT_CTLR_ADV_DATA_LEN_MAX");
+BUILD_ASSERT(PER_AD_LEN <= CONFIG_BT_CTLR_ADV_DATA_LEN_MAX,
+			 "Periodic advertising data exceeds CONFIG_BT_CTLR_ADV_DATA_LEN_MAX");
+#endif
+#endif
+
+static struct bt_le_adv_param adv_param =
+	BT_LE_ADV_PARAM_INIT(BT_LE_ADV_OPT_CONNECTABLE | BT_LE_ADV_OPT_USE_IDENTITY,
+						 BT_GAP_ADV_SLOW_INT_MIN, BT_GAP_ADV_SLOW_INT_MAX, NULL);
+
+/* Set while the legacy advertising is stopped, until adv_restart() starts it */
+static atomic_t adv_stopped = ATOMIC_INIT(1);
+
+static int adv_restart(void);
+
+/* ESS characteristics, in the order they are declared in ess_svc */
+enum ess_channel
+{
+	ESS_TEMPERATURE,
+	ESS_HUMIDITY,
+	ESS_PRESSURE,
+	ESS_CO2,
+	ESS_VOC,
+	ESS_IAQ,
+	ESS_CHANNEL_COUNT,
+};
 
-#define ADV_PARAM BT_LE_ADV_PARAM(BT_LE_ADV_OPT_CONNECTABLE | BT_LE_ADV_OPT_USE_IDENTITY, \
-								  BT_GAP_ADV_SLOW_INT_MIN,                                \
-								  BT_GAP_ADV_SLOW_INT_MAX, NULL)
+struct ess_channel_data
+{
+	/* Last value, in the characteristic format */
+	void *value;
+	size_t size;
+	/* Characteristic value attribute, resolved by bt_init() */
+	const struct bt_gatt_attr *attr;
+	/* At least one client has notifications or indications enabled */
+	bool subscribed;
+	bool is_signed;
+	/* Smallest change notified until the client writes an ES Trigger Setting */
+	int32_t default_delta;
+};
+
+static struct ess_channel_data ess_channels[ESS_CHANNEL_COUNT] = {
+	/* 0.1 degrees Celsius */
+	[ESS_TEMPERATURE] = {.value = &last_temp, .size = sizeof(last_temp),
+						 .is_signed = true, .default_delta = 10},
+	/* 1 % */
+	[ESS_HUMIDITY] = {.value = &last_humidity, .size = sizeof(last_humidity),
+					  .default_delta = 100},
+	/* 10 Pa */
+	[ESS_PRESSURE] = {.value = &last_pressure, .size = sizeof(last_pressure),
+					  .default_delta = 10},
+	/* 20 ppm */
+	[ESS_CO2] = {.value = &last_co2, .size = sizeof(last_co2), .default_delta = 20},
+	/* 50 ppb */
+	[ESS_VOC] = {.value = &last_voc, .size = sizeof(last_voc), .default_delta = 50},
+	[ESS_IAQ] = {.value = &last_iaq, .size = sizeof(last_iaq), .default_delta = 5},
+};
 
-static ssize_t read_temp(struct bt_conn *conn, const struct bt_gatt_attr *attr,
-						 void *buf, uint16_t len, uint16_t offset)
+/* Trigger settings and notification state of one connection */
+struct ess_conn_data
 {
-	return bt_gatt_attr_read(conn, attr, buf, len, offset, &last_temp,
-							 sizeof(last_temp));
+	struct ess_trigger triggers[ESS_CHANNEL_COUNT];
+	struct ess_trigger_state states[ESS_CHANNEL_COUNT];
+};
+
+static struct ess_conn_data ess_conns[CONFIG_BT_MAX_CONN];
+
+/* ESS "Condition not supported" ATT error */
+#define ESS_ERR_CONDITION_NOT_SUPPORTED 0x81
+
+/* ES Measurement descriptor value */
+struct es_measurement
+{
+	uint16_t flags;
+	uint8_t sampling_function;
+	uint8_t measurement_period[3];
+	uint8_t update_interval[3];
+	uint8_t application;
+	uint8_t uncertainty;
+} __packed;
+
+/* Instantaneous air readings. The period and update interval are not
+ * reported because they follow the runtime sample rate.
+ */
+static const struct es_measurement es_measurement = {
+	.sampling_function = 0x01,
+	.application = 0x01,
+};
+
+static int32_t ess_value(const struct ess_channel_data *channel)
+{
+	switch (channel->size)
+	{
+	case sizeof(uint16_t):
+		return channel->is_signed ? *(const int16_t *)channel->value
+								  : *(const uint16_t *)channel->value;
+	default:
+		return *(const int32_t *)channel->value;
+	}
 }
 
-static ssize_t read_humidity(struct bt_conn *conn, const struct bt_gatt_attr *attr,
-							 void *buf, uint16_t len, uint16_t offset)
+static ssize_t read_channel(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+							void *buf, uint16_t len, uint16_t offset)
 {
-	return bt_gatt_attr_read(conn, attr, buf, len, offset, &last_humidity,
-							 sizeof(last_humidity));
+	const struct ess_channel_data *channel = attr->user_data;
+
+	return bt_gatt_attr_read(conn, attr, buf, len, offset, channel->value,
+							 channel->size);
 }
 
-static ssize_t read_pressure(struct bt_conn *conn, const struct bt_gatt_attr *attr,
-							 void *buf, uint16_t len, uint16_t offset)
+static ssize_t read_es_measurement(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+								   void *buf, uint16_t len, uint16_t offset)
 {
-	return bt_gatt_attr_read(conn, attr, buf, len, offset, &last_pressure,
-							 sizeof(last_pressure));
+	return bt_gatt_attr_read(conn, attr, buf, len, offset, &es_measurement,
+							 sizeof(es_measurement));
 }
 
-static ssize_t read_co2(struct bt_conn *conn, const struct bt_gatt_attr *attr,
-						void *buf, uint16_t len, uint16_t offset)
+static ssize_t read_es_trigger(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+							   void *buf, uint16_t len, uint16_t offset)
 {
-	return bt_gatt_attr_read(conn, attr, buf, len, offset, &last_co2,
-							 sizeof(last_co2));
+	const struct ess_channel_data *channel = attr->user_data;
+	const struct ess_trigger *trigger =
+		&ess_conns[bt_conn_index(conn)].triggers[channel - ess_channels];
+	uint8_t value[ESS_TRIGGER_MAX_LEN];
+	size_t value_len = ess_trigger_encode(trigger, value, channel->size);
+
+	return bt_gatt_attr_read(conn, attr, buf, len, offset, value, value_len);
+}
+
+static void ess_triggers_save(struct bt_conn *conn);
+
+static ssize_t write_es_trigger(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+								const void *buf, uint16_t len, uint16_t offset, uint8_t flags)
+{
+	const struct ess_channel_data *channel = attr->user_data;
+	struct ess_trigger trigger;
+
+	ARG_UNUSED(flags);
+
+	if (offset != 0)
+	{
+		return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
+	}
+
+	int err = ess_trigger_decode(&trigger, buf, len, channel->size, channel->is_signed);
+	if (err == -ENOTSUP)
+	{
+		return BT_GATT_ERR(ESS_ERR_CONDITION_NOT_SUPPORTED);
+	}
+	if (err)
+	{
+		return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+	}
+
+	ess_conns[bt_conn_index(conn)].triggers[channel - ess_channels] = trigger;
+	ess_triggers_save(conn);
+
+	return len;
 }
 
-static ssize_t read_voc(struct bt_conn *conn, const struct bt_gatt_attr *attr,
-						void *buf, uint16_t len, uint16_t offset)
+/* Sensor record value attribute, resolved by bt_init() */
+static const struct bt_gatt_attr *record_attr;
+
+static ssize_t read_record(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+						   void *buf, uint16_t len, uint16_t offset)
 {
-	return bt_gatt_attr_read(conn, attr, buf, len, offset, &last_voc,
-							 sizeof(last_voc));
+	return bt_gatt_attr_read(conn, attr, buf, len, offset, &record, sizeof(record));
 }
 
-static ssize_t read_iaq(struct bt_conn *conn, const struct bt_gatt_attr *attr,
-						void *buf, uint16_t len, uint16_t offset)
+/* Channels each connection is known to be subscribed to, one bit per
+ * enum ess_channel plus RECORD_SUBSCRIBED. Used to detect new subscriptions.
+ */
+#define RECORD_SUBSCRIBED BIT(ESS_CHANNEL_COUNT)
+static uint8_t conn_subscribed[CONFIG_BT_MAX_CONN];
+
+/* Indication parameters must stay valid until the peer confirms, so every
+ * connection gets its own set per channel.
+ */
+static struct bt_gatt_indicate_params indicate_params[CONFIG_BT_MAX_CONN][ESS_CHANNEL_COUNT];
+static ATOMIC_DEFINE(indicate_busy, CONFIG_BT_MAX_CONN * ESS_CHANNEL_COUNT);
+
+static void indicate_destroy(struct bt_gatt_indicate_params *params)
 {
-	return bt_gatt_attr_read(conn, attr, buf, len, offset, &last_iaq,
-							 sizeof(last_iaq));
+	atomic_clear_bit(indicate_busy, params - &indicate_params[0][0]);
 }
 
-/* This function is called whenever the CCCD register has been changed by the client*/
-static void on_ccc_cfg_changed(const struct bt_gatt_attr *attr,
-							   uint16_t value)
+static void ess_send(struct bt_conn *conn, enum ess_channel ch)
 {
-	ARG_UNUSED(attr);
-	switch (value)
+	const struct ess_channel_data *channel = &ess_channels[ch];
+	uint8_t index = bt_conn_index(conn);
+	int err;
+
+	if (bt_gatt_is_subscribed(conn, channel->attr, BT_GATT_CCC_NOTIFY))
 	{
-	case BT_GATT_CCC_NOTIFY:
-		// Start sending stuff!
-		break;
+		err = ble_notify_send(conn, ch, channel->attr, channel->value, channel->size);
+	}
+	else if (bt_gatt_is_subscribed(conn, channel->attr, BT_GATT_CCC_INDICATE))
+	{
+		struct bt_gatt_indicate_params *params = &indicate_params[index][ch];
 
-	case BT_GATT_CCC_INDICATE:
-		// Start sending stuff via indications
-		break;
+		/* The previous indication is not confirmed yet, the client will read
+		 * the newer value on the next update.
+		 */
+		if (atomic_test_and_set_bit(indicate_busy, index * ESS_CHANNEL_COUNT + ch))
+		{
+			return;
+		}
 
-	case 0:
-		// Stop sending stuff
-		break;
+		params->attr = channel->attr;
+		params->func = NULL;
+		params->destroy = indicate_destroy;
+		params->data = channel->value;
+		params->len = channel->size;
 
-	default:
-		printk("Error, CCCD has been set to an invalid value");
+		err = bt_gatt_indicate(conn, params);
+		if (err)
+		{
+			atomic_clear_bit(indicate_busy, index * ESS_CHANNEL_COUNT + ch);
+		}
+	}
+	else
+	{
+		return;
+	}
+
+	if (err == 0)
+	{
+		ess_trigger_sent(&ess_conns[index].states[ch], ess_value(channel), k_uptime_get());
+	}
+	else if (err != -ENOTCONN)
+	{
+		LOG_WRN("Failed to send channel %d (err %d)", ch, err);
 	}
 }
 
+/* Notification slot of the sensor record, after the ESS channels */
+#define RECORD_NOTIFY_SLOT ESS_CHANNEL_COUNT
+
+BUILD_ASSERT(RECORD_NOTIFY_SLOT < BLE_NOTIFY_SLOTS);
+BUILD_ASSERT(sizeof(struct sensor_record) <= BLE_NOTIFY_DATA_MAX);
+
+static void record_send(struct bt_conn *conn)
+{
+	if (bt_gatt_is_subscribed(conn, record_attr, BT_GATT_CCC_NOTIFY))
+	{
+		ble_notify_send(conn, RECORD_NOTIFY_SLOT, record_attr, &record, sizeof(record));
+	}
+}
+
+static void record_send_cb(struct bt_conn *conn, void *user_data)
+{
+	ARG_UNUSED(user_data);
+	record_send(conn);
+}
+
+/* Send a channel to a connection if its trigger condition is met */
+static void ess_trigger_cb(struct bt_conn *conn, void *user_data)
+{
+	enum ess_channel ch = *(const enum ess_channel *)user_data;
+	const struct ess_conn_data *conn_data = &ess_conns[bt_conn_index(conn)];
+
+	if (ess_trigger_check(&conn_data->triggers[ch], &conn_data->states[ch],
+						  ess_value(&ess_channels[ch]), k_uptime_get()))
+	{
+		ess_send(conn, ch);
+	}
+}
+
+/* Send the current value of every channel a connection has just subscribed to */
+static void ess_sync_conn(struct bt_conn *conn, void *user_data)
+{
+	uint8_t index = bt_conn_index(conn);
+	uint8_t subscribed = 0;
+
+	ARG_UNUSED(user_data);
+
+	for (int ch = 0; ch < ESS_CHANNEL_COUNT; ch++)
+	{
+		const struct bt_gatt_attr *attr = ess_channels[ch].attr;
+
+		if (attr && bt_gatt_is_subscribed(conn, attr,
+										  BT_GATT_CCC_NOTIFY | BT_GATT_CCC_INDICATE))
+		{
+			subscribed |= BIT(ch);
+		}
+	}
+
+	if (record_attr && bt_gatt_is_subscribed(conn, record_attr, BT_GATT_CCC_NOTIFY))
+	{
+		subscribed |= RECORD_SUBSCRIBED;
+	}
+
+	uint8_t added = subscribed & ~conn_subscribed[index];
+
+	for (int ch = 0; ch < ESS_CHANNEL_COUNT; ch++)
+	{
+		if (added & BIT(ch))
+		{
+			ess_send(conn, ch);
+		}
+	}
+	if (added & RECORD_SUBSCRIBED)
+	{
+		record_send(conn);
+	}
+	conn_subscribed[index] = subscribed;
+}
+
+static void ccc_work_handler(struct k_work *work)
+{
+	ARG_UNUSED(work);
+	bt_conn_foreach(BT_CONN_TYPE_LE, ess_sync_conn, NULL);
+}
+
+static K_WORK_DEFINE(ccc_work, ccc_work_handler);
+
+static bool record_subscribed;
+
+static void on_record_ccc_cfg_changed(const struct bt_gatt_attr *attr,
+									  uint16_t value)
+{
+	ARG_UNUSED(attr);
+
+	record_subscribed = (value & BT_GATT_CCC_NOTIFY) != 0;
+	k_work_submit(&ccc_work);
+}
+
+/* This function is called whenever the CCCD register has been changed by the client.
+ * The value is the aggregate over all connections.
+ */
+static void on_ccc_cfg_changed(const struct bt_gatt_attr *attr,
+							   uint16_t value)
+{
+	/* The CCC descriptor directly follows the characteristic value */
+	struct ess_channel_data *channel = (attr - 1)->user_data;
+
+	if (value & ~(BT_GATT_CCC_NOTIFY | BT_GATT_CCC_INDICATE))
+	{
+		LOG_WRN("Invalid CCC value 0x%04x", value);
+	}
+
+	channel->subscribed = (value & (BT_GATT_CCC_NOTIFY | BT_GATT_CCC_INDICATE)) != 0;
+
+	/* The callback does not say which connection changed, find out from
+	 * the work queue rather than the Bluetooth RX context.
+	 */
+	k_work_submit(&ccc_work);
+}
+
 BT_GATT_SERVICE_DEFINE(ess_svc,
 					   BT_GATT_PRIMARY_SERVICE(BT_UUID_ESS),
 					   /* Temperature Sensor */
 					   BT_GATT_CHARACTERISTIC(BT_UUID_TEMPERATURE,
-											  BT_GATT_CHRC_READ | BT_GATT_CHRC_NOTIFY,
+											  BT_GATT_CHRC_READ | BT_GATT_CHRC_NOTIFY | BT_GATT_CHRC_INDICATE,
 											  BT_GATT_PERM_READ,
-											  read_temp, NULL, NULL),
+											  read_channel, NULL, &ess_channels[ESS_TEMPERATURE]),
 					   BT_GATT_CCC(on_ccc_cfg_changed,
 								   BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
+					   BT_GATT_DESCRIPTOR(BT_UUID_ES_MEASUREMENT, BT_GATT_PERM_READ,
+										  read_es_measurement, NULL, &ess_channels[ESS_TEMPERATURE]),
+					   BT_GATT_DESCRIPTOR(BT_UUID_ES_TRIGGER_SETTING,
+										  BT_GATT_PERM_READ | BT_GATT_PERM_WRITE_ENCRYPT,
+										  read_es_trigger, write_es_trigger,
+										  &ess_channels[ESS_TEMPERATURE]),
 					   BT_GATT_CHARACTERISTIC(BT_UUID_HUMIDITY,
-											  BT_GATT_CHRC_READ | BT_GATT_CHRC_NOTIFY,
+											  BT_GATT_CHRC_READ | BT_GATT_CHRC_NOTIFY | BT_GATT_CHRC_INDICATE,
 											  BT_GATT_PERM_READ,
-											  read_humidity, NULL, NULL),
+											  read_channel, NULL, &ess_channels[ESS_HUMIDITY]),
 					   BT_GATT_CCC(on_ccc_cfg_changed,
 								   BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
+					   BT_GATT_DESCRIPTOR(BT_UUID_ES_MEASUREMENT, BT_GATT_PERM_READ,
+										  read_es_measurement, NULL, &ess_channels[ESS_HUMIDITY]),
+					   BT_GATT_DESCRIPTOR(BT_UUID_ES_TRIGGER_SETTING,
+										  BT_GATT_PERM_READ | BT_GATT_PERM_WRITE_ENCRYPT,
+										  read_es_trigger, write_es_trigger,
+										  &ess_channels[ESS_HUMIDITY]),
 					   BT_GATT_CHARACTERISTIC(BT_UUID_PRESSURE,
-											  BT_GATT_CHRC_READ | BT_GATT_CHRC_NOTIFY,
+											  BT_GATT_CHRC_READ | BT_GATT_CHRC_NOTIFY | BT_GATT_CHRC_INDICATE,
 											  BT_GATT_PERM_READ,
-											  read_pressure, NULL, NULL),
+											  read_channel, NULL, &ess_channels[ESS_PRESSURE]),
 					   BT_GATT_CCC(on_ccc_cfg_changed,
 								   BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
+					   BT_GATT_DESCRIPTOR(BT_UUID_ES_MEASUREMENT, BT_GATT_PERM_READ,
+										  read_es_measurement, NULL, &ess_channels[ESS_PRESSURE]),
+					   BT_GATT_DESCRIPTOR(BT_UUID_ES_TRIGGER_SETTING,
+										  BT_GATT_PERM_READ | BT_GATT_PERM_WRITE_ENCRYPT,
+										  read_es_trigger, write_es_trigger,
+										  &ess_channels[ESS_PRESSURE]),
 					   BT_GATT_CHARACTERISTIC(BT_UUID_GATT_CO2CONC,
-											  BT_GATT_CHRC_READ | BT_GATT_CHRC_NOTIFY,
+											  BT_GATT_CHRC_READ | BT_GATT_CHRC_NOTIFY | BT_GATT_CHRC_INDICATE,
 											  BT_GATT_PERM_READ,
-											  read_co2, NULL, NULL),
+											  read_channel, NULL, &ess_channels[ESS_CO2]),
 					   BT_GATT_CCC(on_ccc_cfg_changed,
 								   BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
+					   BT_GATT_DESCRIPTOR(BT_UUID_ES_MEASUREMENT, BT_GATT_PERM_READ,
+										  read_es_measurement, NULL, &ess_channels[ESS_CO2]),
+					   BT_GATT_DESCRIPTOR(BT_UUID_ES_TRIGGER_SETTING,
+										  BT_GATT_PERM_READ | BT_GATT_PERM_WRITE_ENCRYPT,
+										  read_es_trigger, write_es_trigger,
+										  &ess_channels[ESS_CO2]),
 					   BT_GATT_CHARACTERISTIC(BT_UUID_GATT_VOCCONC,
-											  BT_GATT_CHRC_READ | BT_GATT_CHRC_NOTIFY,
+											  BT_GATT_CHRC_READ | BT_GATT_CHRC_NOTIFY | BT_GATT_CHRC_INDICATE,
 											  BT_GATT_PERM_READ,
-											  read_voc, NULL, NULL),
+											  read_channel, NULL, &ess_channels[ESS_VOC]),
 					   BT_GATT_CCC(on_ccc_cfg_changed,
 								   BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
+					   BT_GATT_DESCRIPTOR(BT_UUID_ES_MEASUREMENT, BT_GATT_PERM_READ,
+										  read_es_measurement, NULL, &ess_channels[ESS_VOC]),
+					   BT_GATT_DESCRIPTOR(BT_UUID_ES_TRIGGER_SETTING,
+										  BT_GATT_PERM_READ | BT_GATT_PERM_WRITE_ENCRYPT,
+										  read_es_trigger, write_es_trigger,
+										  &ess_channels[ESS_VOC]),
 					   BT_GATT_CHARACTERISTIC(BT_UUID_GATT_IAQ,
-											  BT_GATT_CHRC_READ | BT_GATT_CHRC_NOTIFY,
+											  BT_GATT_CHRC_READ | BT_GATT_CHRC_NOTIFY | BT_GATT_CHRC_INDICATE,
 											  BT_GATT_PERM_READ,
-											  read_iaq, NULL, NULL),
+											  read_channel, NULL, &ess_channels[ESS_IAQ]),
 					   BT_GATT_CCC(on_ccc_cfg_changed,
+								   BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
+					   BT_GATT_DESCRIPTOR(BT_UUID_ES_MEASUREMENT, BT_GATT_PERM_READ,
+										  read_es_measurement, NULL, &ess_channels[ESS_IAQ]),
+					   BT_GATT_DESCRIPTOR(BT_UUID_ES_TRIGGER_SETTING,
+										  BT_GATT_PERM_READ | BT_GATT_PERM_WRITE_ENCRYPT,
+										  read_es_trigger, write_es_trigger,
+										  &ess_channels[ESS_IAQ]), );
+
+BT_GATT_SERVICE_DEFINE(ensens_svc,
+					   BT_GATT_PRIMARY_SERVICE(BT_UUID_ENSENS),
+					   BT_GATT_CHARACTERISTIC(BT_UUID_GATT_SENSOR_RECORD,
+											  BT_GATT_CHRC_READ | BT_GATT_CHRC_NOTIFY,
+											  BT_GATT_PERM_READ,
+											  read_record, NULL, NULL),
+					   BT_GATT_CCC(on_record_ccc_cfg_changed,
 								   BT_GATT_PERM_READ | BT_GATT_PERM_WRITE), );
 
 static uint16_t clamp_float_to_uint16(float value)
@@ -189,6 +588,76 @@ static uint16_t clamp_float_to_uint16(float value)
 	return (uint16_t)new_value;
 }
 
+/* Resolve the value attribute of every ESS channel and of the sensor record
+ * once, so updates do not have to search the attribute tables.
+ */
+static void ess_resolve_attrs(void)
+{
+	for (size_t i = 0; i < ess_svc.attr_count; i++)
+	{
+		const struct bt_gatt_attr *attr = &ess_svc.attrs[i];
+
+		if (attr->read == read_channel)
+		{
+			struct ess_channel_data *channel = attr->user_data;
+
+			channel->attr = attr;
+		}
+	}
+
+	for (size_t i = 0; i < ensens_svc.attr_count; i++)
+	{
+		if (ensens_svc.attrs[i].read == read_record)
+		{
+			record_attr = &ensens_svc.attrs[i];
+		}
+	}
+}
+
+/* Encode the legacy BTHome objects for advertising, in a single frame */
+static void adv_encode(void)
+{
+	struct bthome_object objects[ARRAY_SIZE(adv_legacy_objects)];
+	size_t encoded;
+
+	for (size_t i = 0; i < ARRAY_SIZE(adv_legacy_objects); i++)
+	{
+		objects[i] = adv_objects[adv_legacy_objects[i]];
+	}
+
+	ad[1].data_len = bthome_encode(adv_service_data, sizeof(adv_service_data), packet_id,
+								   objects, ARRAY_SIZE(objects), &encoded);
+	__ASSERT(encoded == ARRAY_SIZE(objects),
+			 "BTHome objects do not fit in the legacy advertising payload");
+}
+
+#if CONFIG_APP_BT_EXT_ADV
+/* Put every BTHome object in the extended advertising, and the sensor record
+ * next to them in the periodic advertising for synchronized gateways.
+ */
+static void ext_adv_update(void)
+{
+	size_t encoded;
+	size_t len = bthome_encode(ext_service_data, sizeof(ext_service_data), packet_id,
+							   adv_objects, ARRAY_SIZE(adv_objects), &encoded);
+
+	memcpy(&ext_record_data[BT_UUID_SIZE_128], &record, sizeof(record));
+
+	const struct bt_data ext_ad[] = {
+		BT_DATA(BT_DATA_NAME_COMPLETE, unique_name, ADV_NAME_LEN),
+		BT_DATA(BT_DATA_SVC_DATA16, ext_service_data, len),
+	};
+	const struct bt_data per_ad[] = {
+		BT_DATA(BT_DATA_SVC_DATA16, ext_service_data, len),
+		BT_DATA(BT_DATA_SVC_DATA128, ext_record_data, sizeof(ext_record_data)),
+	};
+
+	ble_ext_adv_set_data(ext_ad, ARRAY_SIZE(ext_ad), per_ad, ARRAY_SIZE(per_ad));
+}
+#endif
+
+static struct bt_conn_auth_info_cb auth_info_callbacks;
+
 int bt_init()
 {
 	int err = 0;
@@ -198,6 +667,8 @@ int bt_init()
 	hw_id_get(buf, HW_ID_LEN);
 
 	memcpy(unique_name, CONFIG_BT_DEVICE_NAME, sizeof(CONFIG_BT_DEVICE_NAME));
+	ess_resolve_attrs();
+	bt_conn_auth_info_cb_register(&auth_info_callbacks);
 
 	if (IS_ENABLED(CONFIG_SETTINGS))
 	{
@@ -206,142 +677,348 @@ int bt_init()
 
 	memcpy(&unique_name[3], &buf[HW_ID_LEN - 4], 3);
 
-	err = bt_le_adv_start(ADV_PARAM, ad, ARRAY_SIZE(ad), NULL, 0);
-	if (err)
+	adv_encode();
+	err = adv_restart();
+	bt_set_name(unique_name);
+	bt_le_adv_update_data(ad, ARRAY_SIZE(ad), sd, ARRAY_SIZE(sd));
+
+#if CONFIG_APP_BT_EXT_ADV
+	const uint8_t ensens_uuid[] = {BT_UUID_ENSENS_VAL};
+
+	memcpy(ext_record_data, ensens_uuid, sizeof(ensens_uuid));
+	if (ble_ext_adv_start() == 0)
 	{
-		LOG_ERR("Failed to start the Bluetooth advertisement (err %d)", err);
+		ext_adv_update();
 	}
-	bt_set_name(unique_name);
-	bt_le_adv_update_data(ad, ARRAY_SIZE(ad), NULL, 0);
+#endif
 
 	return err;
 }
 
-void bt_set_temperature(float temp)
+/* Store a new channel value and send it to the clients whose trigger
+ * condition is met.
+ *
+ * @return true if the value changed.
+ */
+static bool ess_update(enum ess_channel ch, const void *value)
 {
-	int16_t new_value = (int16_t)(temp * 100.0f);
-	if (last_temp != new_value)
-	{
-		last_temp = new_value;
-		service_data[IDX_TEMPH] = last_temp >> 8;
-		service_data[IDX_TEMPL] = last_temp & 0xff;
+	struct ess_channel_data *channel = &ess_channels[ch];
+	bool changed = memcmp(channel->value, value, channel->size) != 0;
+
+	memcpy(channel->value, value, channel->size);
 
-		struct bt_gatt_attr *attr;
-		attr = bt_gatt_find_by_uuid(ess_svc.attrs, ess_svc.attr_count, BT_UUID_TEMPERATURE);
-		bt_gatt_notify(NULL, attr, &last_temp, sizeof(last_temp));
+	/* Triggers are evaluated even for an unchanged value, a fixed interval
+	 * trigger may be due.
+	 */
+	if (channel->attr && channel->subscribed)
+	{
+		bt_conn_foreach(BT_CONN_TYPE_LE, ess_trigger_cb, &ch);
 	}
+	return changed;
+}
+
+void bt_set_temperature(float temp)
+{
+	int16_t new_value = (int16_t)(temp * 100.0f);
+	ess_update(ESS_TEMPERATURE, &new_value);
+	adv_objects[ADV_TEMPERATURE].value = (uint32_t)new_value;
 }
 
 void bt_set_humidity(float humidity)
 {
 	uint16_t new_value = (uint16_t)(humidity * 100.0f);
-	if (last_humidity != new_value)
-	{
-		last_humidity = new_value;
-		service_data[IDX_HUMH] = last_humidity >> 8;
-		service_data[IDX_HUML] = last_humidity & 0xff;
-
-		struct bt_gatt_attr *attr;
-		attr = bt_gatt_find_by_uuid(ess_svc.attrs, ess_svc.attr_count, BT_UUID_HUMIDITY);
-		bt_gatt_notify(NULL, attr, &last_humidity, sizeof(last_humidity));
-	}
+	ess_update(ESS_HUMIDITY, &new_value);
+	adv_objects[ADV_HUMIDITY].value = new_value;
 }
 
 void bt_set_pressure(float pressure)
 {
 	uint32_t new_value = (uint32_t)pressure;
-	if (last_pressure != new_value)
-	{
-		last_pressure = new_value;
-		service_data[IDX_PRESSUREH] = last_pressure >> 16 & 0xff;
-		service_data[IDX_PRESSUREL + 1] = last_pressure >> 8 & 0xff;
-		service_data[IDX_PRESSUREL] = last_pressure & 0xff;
-
-		struct bt_gatt_attr *attr;
-		attr = bt_gatt_find_by_uuid(ess_svc.attrs, ess_svc.attr_count, BT_UUID_PRESSURE);
-		bt_gatt_notify(NULL, attr, &last_pressure, sizeof(last_pressure));
-	}
+	ess_update(ESS_PRESSURE, &new_value);
+	/* Pa is the BTHome 0.01 hPa unit */
+	adv_objects[ADV_PRESSURE].value = new_value;
 }
 
 void bt_set_co2(float co2)
 {
 	uint16_t new_value = clamp_float_to_uint16(co2);
-	if (last_co2 != new_value)
+	ess_update(ESS_CO2, &new_value);
+	adv_objects[ADV_CO2].value = new_value;
+}
+
+void bt_set_voc(float voc)
+{
+	uint16_t new_value = clamp_float_to_uint16(voc * 1000.0f);
+	ess_update(ESS_VOC, &new_value);
+	adv_objects[ADV_TVOC].value = clamp_float_to_uint16(voc * 1000.0f * TVOC_UG_M3_PER_PPB);
+}
+
+void bt_set_iaq(uint16_t iaq)
+{
+	ess_update(ESS_IAQ, &iaq);
+	adv_objects[ADV_IAQ].value = iaq;
+}
+
+void bt_set_battery(uint8_t batt)
+{
+	if (last_batt != batt)
+	{
+		last_batt = batt;
+		adv_objects[ADV_BATTERY].value = batt;
+		bt_bas_set_battery_level(batt);
+	}
+}
+
+void bt_set_sensor_status(uint8_t iaq_accuracy, uint8_t co2_accuracy, uint8_t voc_accuracy,
+						  bool run_in, bool stabilized)
+{
+	last_status = SENSOR_RECORD_STATUS_IAQ_ACC(iaq_accuracy) |
+				  SENSOR_RECORD_STATUS_CO2_ACC(co2_accuracy) |
+				  SENSOR_RECORD_STATUS_VOC_ACC(voc_accuracy) |
+				  (run_in ? SENSOR_RECORD_STATUS_RUN_IN : 0) |
+				  (stabilized ? SENSOR_RECORD_STATUS_STABILIZED : 0);
+	adv_objects[ADV_IAQ_ACCURACY].value = iaq_accuracy;
+	adv_objects[ADV_STABILIZED].value = stabilized;
+}
+
+void bt_publish_record(int64_t timestamp_ms)
+{
+	record.seq++;
+	record.timestamp = sys_cpu_to_le32((uint32_t)(timestamp_ms / MSEC_PER_SEC));
+	record.temperature = sys_cpu_to_le16(last_temp);
+	record.humidity = sys_cpu_to_le16(last_humidity);
+	sys_put_le24(last_pressure, record.pressure);
+	record.co2 = sys_cpu_to_le16(last_co2);
+	record.voc = sys_cpu_to_le16(last_voc);
+	record.iaq = sys_cpu_to_le16(last_iaq);
+	record.battery = last_batt;
+	record.status = last_status;
+
+	/* One notification carries every channel, so subscribers of the record
+	 * can leave the ESS characteristics unsubscribed.
+	 */
+	if (record_attr && record_subscribed)
 	{
-		last_co2 = new_value;
-		service_data[IDX_CO2H] = last_co2 >> 8;
-		service_data[IDX_CO2L] = last_co2 & 0xff;
+		bt_conn_foreach(BT_CONN_TYPE_LE, record_send_cb, NULL);
+	}
+}
 
-		struct bt_gatt_attr *attr;
-		attr = bt_gatt_find_by_uuid(ess_svc.attrs, ess_svc.attr_count, BT_UUID_GATT_CO2CONC);
-		bt_gatt_notify(NULL, attr, &last_co2, sizeof(last_co2));
+/* Trigger settings of bonded peers are stored under "ess/<address><type>" */
+#define ESS_SETTINGS_KEY_LEN sizeof("ess/0123456789ab0")
+
+static void ess_settings_key(char *key, size_t size, const bt_addr_le_t *addr)
+{
+	snprintk(key, size, "ess/%02x%02x%02x%02x%02x%02x%u", addr->a.val[5], addr->a.val[4],
+			 addr->a.val[3], addr->a.val[2], addr->a.val[1], addr->a.val[0], addr->type);
+}
+
+static int ess_triggers_load_handler(const char *key, size_t len,
+									 settings_read_cb read_cb, void *cb_arg, void *param)
+{
+	ARG_UNUSED(key);
+	struct ess_conn_data *conn_data = param;
+
+	if (len != sizeof(conn_data->triggers) ||
+		read_cb(cb_arg, conn_data->triggers, len) != (ssize_t)len)
+	{
+		return -EINVAL;
 	}
+	return 0;
 }
 
-void bt_set_voc(float voc)
+/* Reset the trigger settings of a new connection, restoring them for a
+ * bonded peer.
+ */
+static void ess_triggers_load(struct bt_conn *conn)
 {
-	uint16_t new_value = clamp_float_to_uint16(voc * 1000.0f);
-	if (last_voc != new_value)
+	struct ess_conn_data *conn_data = &ess_conns[bt_conn_index(conn)];
+	const bt_addr_le_t *addr = bt_conn_get_dst(conn);
+
+	memset(conn_data, 0, sizeof(*conn_data));
+	for (int ch = 0; ch < ESS_CHANNEL_COUNT; ch++)
+	{
+		conn_data->triggers[ch].condition = ESS_TRIGGER_VALUE_CHANGED;
+		conn_data->triggers[ch].operand = ess_channels[ch].default_delta;
+	}
+
+	if (IS_ENABLED(CONFIG_SETTINGS) && bt_le_bond_exists(BT_ID_DEFAULT, addr))
 	{
-		last_voc = new_value;
+		char key[ESS_SETTINGS_KEY_LEN];
 
-		struct bt_gatt_attr *attr;
-		attr = bt_gatt_find_by_uuid(ess_svc.attrs, ess_svc.attr_count, BT_UUID_GATT_VOCCONC);
-		bt_gatt_notify(NULL, attr, &last_voc, sizeof(last_voc));
+		ess_settings_key(key, sizeof(key), addr);
+		settings_load_subtree_direct(key, ess_triggers_load_handler, conn_data);
 	}
 }
 
-void bt_set_iaq(uint16_t iaq)
+static void ess_triggers_save(struct bt_conn *conn)
 {
-	if (last_iaq != iaq)
+	const bt_addr_le_t *addr = bt_conn_get_dst(conn);
+
+	if (!IS_ENABLED(CONFIG_SETTINGS) || !bt_le_bond_exists(BT_ID_DEFAULT, addr))
 	{
-		last_iaq = iaq;
+		return;
+	}
 
-		struct bt_gatt_attr *attr;
-		attr = bt_gatt_find_by_uuid(ess_svc.attrs, ess_svc.attr_count, BT_UUID_GATT_IAQ);
-		bt_gatt_notify(NULL, attr, &last_iaq, sizeof(last_iaq));
+	char key[ESS_SETTINGS_KEY_LEN];
+
+	ess_settings_key(key, sizeof(key), addr);
+	int err = settings_save_one(key, ess_conns[bt_conn_index(conn)].triggers,
+								sizeof(ess_conns[0].triggers));
+	if (err)
+	{
+		LOG_ERR("Failed to save the trigger settings (err %d)", err);
 	}
 }
 
-void bt_set_battery(uint8_t batt)
+static void bond_deleted(uint8_t id, const bt_addr_le_t *peer)
 {
-	if (last_batt != batt)
+	char key[ESS_SETTINGS_KEY_LEN];
+
+	ARG_UNUSED(id);
+
+	if (IS_ENABLED(CONFIG_SETTINGS))
 	{
-		last_batt = batt;
-		service_data[IDX_BATT] = batt;
-		bt_bas_set_battery_level(batt);
+		ess_settings_key(key, sizeof(key), peer);
+		settings_delete(key);
 	}
 }
 
-static int connectionNumber = 0;
+static struct bt_conn_auth_info_cb auth_info_callbacks = {
+	.bond_deleted = bond_deleted,
+};
 
 static void connected(struct bt_conn *conn, uint8_t err)
 {
 	if (!err)
 	{
-		connectionNumber++;
+		ess_triggers_load(conn);
+		ble_notify_reset(conn);
+		conn_policy_connected(conn);
 	}
 }
 
 static void disconnected(struct bt_conn *conn, uint8_t reason)
 {
-	connectionNumber--;
+	struct ble_notify_stats stats;
+
+	conn_subscribed[bt_conn_index(conn)] = 0;
+	conn_policy_disconnected(conn);
+
+	ble_notify_get_stats(&stats);
+	LOG_INF("Disconnected (reason 0x%02x), notifications since boot: %u sent, %u coalesced, "
+			"%u dropped",
+			reason, stats.sent, stats.coalesced, stats.dropped);
 }
 
 bool bt_connection_exists()
 {
-	return connectionNumber > 0;
+	return conn_policy_count() > 0;
 }
 
 void update_advertise_data()
 {
-	int err = bt_le_adv_update_data(ad, ARRAY_SIZE(ad), NULL, 0);
+	/* Values last handed to the controller */
+	static uint32_t adv_values[ADV_OBJECT_COUNT];
+	bool changed = false;
+
+	for (size_t i = 0; i < ARRAY_SIZE(adv_objects); i++)
+	{
+		if (adv_objects[i].value != adv_values[i])
+		{
+			adv_values[i] = adv_objects[i].value;
+			changed = true;
+		}
+	}
+
+	/* Same payload, no need to wake the controller up */
+	if (!changed)
+	{
+		return;
+	}
+
+	/* A new packet ID tells receivers the values changed */
+	packet_id++;
+	adv_encode();
+
+	int err = bt_le_adv_update_data(ad, ARRAY_SIZE(ad), sd, ARRAY_SIZE(sd));
 	if (err)
 	{
 		LOG_ERR("Failed to update the Bluetooth advertisement data (err %d)", err);
 	}
+#if CONFIG_APP_BT_EXT_ADV
+	ext_adv_update();
+#endif
+}
+
+/* Start the legacy advertising with adv_param, it is stopped until this
+ * succeeds
+ */
+static int adv_restart(void)
+{
+	int err = bt_le_adv_start(&adv_param, ad, ARRAY_SIZE(ad), sd, ARRAY_SIZE(sd));
+	if (err && err != -EALREADY)
+	{
+		LOG_ERR("Failed to start the Bluetooth advertisement (err %d)", err);
+		return err;
+	}
+	atomic_clear(&adv_stopped);
+	return 0;
+}
+
+static void adv_restart_work_handler(struct k_work *work)
+{
+	ARG_UNUSED(work);
+
+	if (atomic_get(&adv_stopped))
+	{
+		adv_restart();
+	}
+}
+
+static K_WORK_DEFINE(adv_restart_work, adv_restart_work_handler);
+
+/* A connection object is free again, which a failed restart may have
+ * been waiting for
+ */
+static void recycled(void)
+{
+	if (atomic_get(&adv_stopped))
+	{
+		k_work_submit(&adv_restart_work);
+	}
+}
+
+int bt_set_adv_interval(uint16_t interval_min, uint16_t interval_max)
+{
+	if (!atomic_get(&adv_stopped) && adv_param.interval_min == interval_min &&
+		adv_param.interval_max == interval_max)
+	{
+		return 0;
+	}
+
+	/* Legacy advertising parameters can only be changed by restarting it.
+	 * Stopping it also cancels the restart after a connection, so it stays
+	 * stopped until adv_restart() succeeds, here or once a connection is
+	 * recycled.
+	 */
+	if (!atomic_get(&adv_stopped))
+	{
+		int err = bt_le_adv_stop();
+		if (err)
+		{
+			LOG_ERR("Failed to stop the Bluetooth advertisement (err %d)", err);
+			return err;
+		}
+		atomic_set(&adv_stopped, 1);
+	}
+
+	adv_param.interval_min = interval_min;
+	adv_param.interval_max = interval_max;
+
+	return adv_restart();
 }
 
 BT_CONN_CB_DEFINE(conn_callbacks) = {
 	.connected = connected,
-	.disconnected = disconnected};
+	.disconnected = disconnected,
+	.recycled = recycled};
@@ -24,6 +24,83 @@ extern "C"
 #define BT_UUID_GATT_IAQ \
     BT_UUID_DECLARE_128(BT_UUID_GATT_IAQ_VAL)
 
+/**
+ *  @brief EnSens vendor service UUID Value
+ */
+#define BT_UUID_ENSENS_VAL 0xDB, 0xA7, 0xBD, 0x48, 0x12, 0x12, 0xBA, 0x82, \
+                           0xD6, 0x43, 0x86, 0x12, 0x98, 0x05, 0x89, 0xE2
+/**
+ *  @brief EnSens vendor service
+ */
+#define BT_UUID_ENSENS \
+    BT_UUID_DECLARE_128(BT_UUID_ENSENS_VAL)
+
+/**
+ *  @brief GATT Characteristic sensor record UUID Value
+ */
+#define BT_UUID_GATT_SENSOR_RECORD_VAL 0xDC, 0xA7, 0xBD, 0x48, 0x12, 0x12, 0xBA, 0x82, \
+                                       0xD6, 0x43, 0x86, 0x12, 0x98, 0x05, 0x89, 0xE2
+/**
+ *  @brief GATT Characteristic sensor record, all channels packed in one value
+ */
+#define BT_UUID_GATT_SENSOR_RECORD \
+    BT_UUID_DECLARE_128(BT_UUID_GATT_SENSOR_RECORD_VAL)
+
+/**
+ *  @brief Telemetry log service UUID Value
+ */
+#define BT_UUID_LOG_SERVICE_VAL 0xDD, 0xA7, 0xBD, 0x48, 0x12, 0x12, 0xBA, 0x82, \
+                                0xD6, 0x43, 0x86, 0x12, 0x98, 0x05, 0x89, 0xE2
+/**
+ *  @brief Telemetry log service
+ */
+#define BT_UUID_LOG_SERVICE \
+    BT_UUID_DECLARE_128(BT_UUID_LOG_SERVICE_VAL)
+
+/**
+ *  @brief GATT Characteristic log control point UUID Value
+ */
+#define BT_UUID_GATT_LOG_CONTROL_VAL 0xDE, 0xA7, 0xBD, 0x48, 0x12, 0x12, 0xBA, 0x82, \
+                                     0xD6, 0x43, 0x86, 0x12, 0x98, 0x05, 0x89, 0xE2
+/**
+ *  @brief GATT Characteristic log control point, starts and aborts transfers
+ */
+#define BT_UUID_GATT_LOG_CONTROL \
+    BT_UUID_DECLARE_128(BT_UUID_GATT_LOG_CONTROL_VAL)
+
+/**
+ *  @brief GATT Characteristic log data UUID Value
+ */
+#define BT_UUID_GATT_LOG_DATA_VAL 0xDF, 0xA7, 0xBD, 0x48, 0x12, 0x12, 0xBA, 0x82, \
+                                  0xD6, 0x43, 0x86, 0x12, 0x98, 0x05, 0x89, 0xE2
+/**
+ *  @brief GATT Characteristic log data, notifies the records of a transfer
+ */
+#define BT_UUID_GATT_LOG_DATA \
+    BT_UUID_DECLARE_128(BT_UUID_GATT_LOG_DATA_VAL)
+
+/**
+ *  @brief Calibration service UUID Value
+ */
+#define BT_UUID_CALIBRATION_SERVICE_VAL 0xE0, 0xA7, 0xBD, 0x48, 0x12, 0x12, 0xBA, 0x82, \
+                                        0xD6, 0x43, 0x86, 0x12, 0x98, 0x05, 0x89, 0xE2
+/**
+ *  @brief Calibration service
+ */
+#define BT_UUID_CALIBRATION_SERVICE \
+    BT_UUID_DECLARE_128(BT_UUID_CALIBRATION_SERVICE_VAL)
+
+/**
+ *  @brief GATT Characteristic calibration state UUID Value
+ */
+#define BT_UUID_GATT_CALIBRATION_VAL 0xE1, 0xA7, 0xBD, 0x48, 0x12, 0x12, 0xBA, 0x82, \
+                                     0xD6, 0x43, 0x86, 0x12, 0x98, 0x05, 0x89, 0xE2
+/**
+ *  @brief GATT Characteristic calibration state, the exported BSEC state
+ */
+#define BT_UUID_GATT_CALIBRATION \
+    BT_UUID_DECLARE_128(BT_UUID_GATT_CALIBRATION_VAL)
+
     /**
      * @brief Initializes the Bluetooth, starts advertising.
      *
@@ -80,6 +157,28 @@ extern "C"
      */
     void bt_set_battery(uint8_t batt);
 
+    /**
+     * @brief Sets the BSEC accuracy and status for Bluetooth transmission.
+     *
+     * @param iaq_accuracy IAQ accuracy, 0 (unreliable) to 3 (high).
+     * @param co2_accuracy CO2 accuracy, 0 (unreliable) to 3 (high).
+     * @param voc_accuracy VOC accuracy, 0 (unreliable) to 3 (high).
+     * @param run_in true if the gas sensor run-in is complete.
+     * @param stabilized true if the gas sensor is stabilized.
+     */
+    void bt_set_sensor_status(uint8_t iaq_accuracy, uint8_t co2_accuracy, uint8_t voc_accuracy,
+                              bool run_in, bool stabilized);
+
+    /**
+     * @brief Packs the values set so far into one sensor record and notifies
+     *  it to subscribed clients.
+     *
+     * Call it once per measurement, after all the values have been set.
+     *
+     * @param timestamp_ms Time the values were measured at, in milliseconds of uptime.
+     */
+    void bt_publish_record(int64_t timestamp_ms);
+
     /**
      * @brief Checks if a Bluetooth connection exists.
      *
@@ -88,10 +187,20 @@ extern "C"
     bool bt_connection_exists();
 
     /**
-     * @brief Updates the Bluetooth advertising data.
+     * @brief Updates the Bluetooth advertising data if the advertised values changed.
      */
     void update_advertise_data();
 
+    /**
+     * @brief Sets the advertising interval, restarting advertising if it changed.
+     *
+     * @param interval_min Minimum advertising interval, in units of 0.625 ms.
+     * @param interval_max Maximum advertising interval, in units of 0.625 ms.
+     *
+     * @return 0 if success, error code if failure.
+     */
+    int bt_set_adv_interval(uint16_t interval_min, uint16_t interval_max);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2025 Grovety Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/gap.h>
+
+#include "ble_ext_adv.h"
+
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_DECLARE(app, CONFIG_APP_LOG_LEVEL);
+
+#define EXT_ADV_INTERVAL BT_GAP_MS_TO_ADV_INTERVAL(CONFIG_APP_BT_EXT_ADV_INTERVAL_MS)
+#define PER_ADV_INTERVAL BT_GAP_MS_TO_PER_ADV_INTERVAL(CONFIG_APP_BT_PER_ADV_INTERVAL_MS)
+
+static struct bt_le_ext_adv *ext_adv;
+
+int ble_ext_adv_start(void)
+{
+	/* Non-connectable and non-scannable, the whole payload is in the
+	 * advertising data so gateways do not need to scan actively.
+	 */
+	const struct bt_le_adv_param param = BT_LE_ADV_PARAM_INIT(
+		BT_LE_ADV_OPT_EXT_ADV | BT_LE_ADV_OPT_USE_IDENTITY |
+			(IS_ENABLED(CONFIG_APP_BT_EXT_ADV_CODED) ? BT_LE_ADV_OPT_CODED : 0),
+		EXT_ADV_INTERVAL, EXT_ADV_INTERVAL, NULL);
+	const struct bt_le_per_adv_param per_param =
+		BT_LE_PER_ADV_PARAM_INIT(PER_ADV_INTERVAL, PER_ADV_INTERVAL, BT_LE_PER_ADV_OPT_NONE);
+
+	int err = bt_le_ext_adv_create(&param, NULL, &ext_adv);
+	if (err)
+	{
+		LOG_ERR("Failed to create the extended advertising set (err %d)", err);
+		ext_adv = NULL;
+		return err;
+	}
+
+	err = bt_le_per_adv_set_param(ext_adv, &per_param);
+	if (err)
+	{
+		LOG_ERR("Failed to set the periodic advertising parameters (err %d)", err);
+		goto fail;
+	}
+
+	err = bt_le_per_adv_start(ext_adv);
+	if (err)
+	{
+		LOG_ERR("Failed to start the periodic advertising (err %d)", err);
+		goto fail;
+	}
+
+	err = bt_le_ext_adv_start(ext_adv, BT_LE_EXT_ADV_START_DEFAULT);
+	if (err)
+	{
+		LOG_ERR("Failed to start the extended advertising (err %d)", err);
+		(void)bt_le_per_adv_stop(ext_adv);
+		goto fail;
+	}
+	return 0;
+
+fail:
+	/* Do not leave a set behind that is never started */
+	(void)bt_le_ext_adv_delete(ext_adv);
+	ext_adv = NULL;
+	return err;
+}
+
+int ble_ext_adv_set_data(const struct bt_data *ad, size_t ad_len,
+						 const struct bt_data *per_ad, size_t per_ad_len)
+{
+	if (!ext_adv)
+	{
+		return -ENODEV;
+	}
+
+	int err = bt_le_ext_adv_set_data(ext_adv, ad, ad_len, NULL, 0);
+	if (err)
+	{
+		LOG_ERR("Failed to update the extended advertising data (err %d)", err);
+		return err;
+	}
+
+	err = bt_le_per_adv_set_data(ext_adv, per_ad, per_ad_len);
+	if (err)
+	{
+		LOG_ERR("Failed to update the periodic advertising data (err %d)", err);
+	}
+	return err;
+}
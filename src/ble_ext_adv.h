@@ -0,0 +1,40 @@
+/*
+ * Copyright (c) 2025 Grovety Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <zephyr/bluetooth/bluetooth.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief Creates the non-connectable extended advertising set and starts
+     *  extended and periodic advertising on it.
+     *
+     * @return 0 if success, error code if failure.
+     */
+    int ble_ext_adv_start(void);
+
+    /**
+     * @brief Updates the data of the extended and periodic advertising.
+     *
+     * @param ad Extended advertising data.
+     * @param ad_len Number of elements in ad.
+     * @param per_ad Periodic advertising data.
+     * @param per_ad_len Number of elements in per_ad.
+     *
+     * @return 0 if success, error code if failure.
+     */
+    int ble_ext_adv_set_data(const struct bt_data *ad, size_t ad_len,
+                             const struct bt_data *per_ad, size_t per_ad_len);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,179 @@
+/*
+ * Copyright (c) 2025 Grovety Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+
+#include "ble_notify.h"
+
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_DECLARE(app, CONFIG_APP_LOG_LEVEL);
+
+struct notify_slot
+{
+	const struct bt_gatt_attr *attr;
+	uint8_t data[BLE_NOTIFY_DATA_MAX];
+	uint16_t len;
+	bool pending;
+};
+
+struct notify_conn
+{
+	atomic_t in_flight;
+	struct notify_slot slots[BLE_NOTIFY_SLOTS];
+};
+
+static struct notify_conn notify_conns[CONFIG_BT_MAX_CONN];
+static struct k_spinlock notify_lock;
+
+static atomic_t stats_sent;
+static atomic_t stats_coalesced;
+static atomic_t stats_dropped;
+
+static void flush_work_handler(struct k_work *work);
+
+static K_WORK_DEFINE(flush_work, flush_work_handler);
+
+static void notify_complete(struct bt_conn *conn, void *user_data)
+{
+	struct notify_conn *nc = &notify_conns[bt_conn_index(conn)];
+
+	ARG_UNUSED(user_data);
+
+	/* A late completion after ble_notify_reset() must not go below zero */
+	atomic_val_t in_flight;
+	do
+	{
+		in_flight = atomic_get(&nc->in_flight);
+		if (in_flight == 0)
+		{
+			break;
+		}
+	} while (!atomic_cas(&nc->in_flight, in_flight, in_flight - 1));
+
+	k_work_submit(&flush_work);
+}
+
+/* Send the pending values of one connection, within its in flight budget.
+ * Runs on the system work queue, where the stack does not wait for buffers.
+ */
+static void flush_conn(struct bt_conn *conn, void *user_data)
+{
+	struct notify_conn *nc = &notify_conns[bt_conn_index(conn)];
+	uint8_t data[BLE_NOTIFY_DATA_MAX];
+
+	ARG_UNUSED(user_data);
+
+	for (int i = 0; i < BLE_NOTIFY_SLOTS; i++)
+	{
+		struct notify_slot *slot = &nc->slots[i];
+
+		if (atomic_get(&nc->in_flight) >= CONFIG_APP_BT_NOTIFY_MAX_IN_FLIGHT)
+		{
+			return;
+		}
+
+		k_spinlock_key_t key = k_spin_lock(&notify_lock);
+		if (!slot->pending)
+		{
+			k_spin_unlock(&notify_lock, key);
+			continue;
+		}
+		struct bt_gatt_notify_params params = {
+			.attr = slot->attr,
+			.data = data,
+			.len = slot->len,
+			.func = notify_complete,
+		};
+		memcpy(data, slot->data, slot->len);
+		slot->pending = false;
+		k_spin_unlock(&notify_lock, key);
+
+		atomic_inc(&nc->in_flight);
+		int err = bt_gatt_notify_cb(conn, &params);
+		if (err == 0)
+		{
+			atomic_inc(&stats_sent);
+			continue;
+		}
+		atomic_dec(&nc->in_flight);
+
+		if (err == -ENOMEM || err == -ENOBUFS)
+		{
+			/* Out of buffers, retry on the next completion unless a newer
+			 * value was queued meanwhile.
+			 */
+			key = k_spin_lock(&notify_lock);
+			if (!slot->pending)
+			{
+				memcpy(slot->data, data, params.len);
+				slot->len = params.len;
+				slot->pending = true;
+			}
+			k_spin_unlock(&notify_lock, key);
+			return;
+		}
+
+		atomic_inc(&stats_dropped);
+		if (err != -ENOTCONN)
+		{
+			LOG_WRN("Failed to notify (err %d)", err);
+		}
+	}
+}
+
+static void flush_work_handler(struct k_work *work)
+{
+	ARG_UNUSED(work);
+	bt_conn_foreach(BT_CONN_TYPE_LE, flush_conn, NULL);
+}
+
+int ble_notify_send(struct bt_conn *conn, uint8_t slot, const struct bt_gatt_attr *attr,
+					const void *data, uint16_t len)
+{
+	if (slot >= BLE_NOTIFY_SLOTS || len > BLE_NOTIFY_DATA_MAX)
+	{
+		return -EINVAL;
+	}
+
+	struct notify_slot *s = &notify_conns[bt_conn_index(conn)].slots[slot];
+	k_spinlock_key_t key = k_spin_lock(&notify_lock);
+
+	if (s->pending)
+	{
+		atomic_inc(&stats_coalesced);
+	}
+	s->attr = attr;
+	memcpy(s->data, data, len);
+	s->len = len;
+	s->pending = true;
+	k_spin_unlock(&notify_lock, key);
+
+	k_work_submit(&flush_work);
+	return 0;
+}
+
+void ble_notify_reset(struct bt_conn *conn)
+{
+	struct notify_conn *nc = &notify_conns[bt_conn_index(conn)];
+	k_spinlock_key_t key = k_spin_lock(&notify_lock);
+
+	for (int i = 0; i < BLE_NOTIFY_SLOTS; i++)
+	{
+		nc->slots[i].pending = false;
+	}
+	atomic_set(&nc->in_flight, 0);
+	k_spin_unlock(&notify_lock, key);
+}
+
+void ble_notify_get_stats(struct ble_notify_stats *stats)
+{
+	stats->sent = atomic_get(&stats_sent);
+	stats->coalesced = atomic_get(&stats_coalesced);
+	stats->dropped = atomic_get(&stats_dropped);
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2025 Grovety Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/gatt.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** Number of values that can be pending per connection */
+#define BLE_NOTIFY_SLOTS 8
+
+/** Largest notified value */
+#define BLE_NOTIFY_DATA_MAX 20
+
+    /**
+     * @brief Notification counters, since boot.
+     */
+    struct ble_notify_stats
+    {
+        /** Notifications handed to the stack. */
+        uint32_t sent;
+        /** Pending values replaced by a newer one before they were sent. */
+        uint32_t coalesced;
+        /** Notifications the stack refused for another reason than buffers. */
+        uint32_t dropped;
+    };
+
+    /**
+     * @brief Queues a notification.
+     *
+     * The value is sent from the system work queue once the connection has
+     * less than CONFIG_APP_BT_NOTIFY_MAX_IN_FLIGHT notifications in flight.
+     * If the previous value of the same slot is still pending, it is replaced
+     * so a slow peer only gets the newest value.
+     *
+     * @param conn Connection to notify.
+     * @param slot Slot of the value, below BLE_NOTIFY_SLOTS.
+     * @param attr Characteristic value attribute.
+     * @param data Value, copied before returning.
+     * @param len Length of the value, at most BLE_NOTIFY_DATA_MAX.
+     *
+     * @return 0 if success, -EINVAL if the slot or length is out of range.
+     */
+    int ble_notify_send(struct bt_conn *conn, uint8_t slot, const struct bt_gatt_attr *attr,
+                        const void *data, uint16_t len);
+
+    /**
+     * @brief Forgets the pending values and in flight notifications of a
+     *  connection. Call it when the connection is established.
+     *
+     * @param conn Connection to reset.
+     */
+    void ble_notify_reset(struct bt_conn *conn);
+
+    /**
+     * @brief Provides the notification counters.
+     *
+     * @param stats Counters.
+     */
+    void ble_notify_get_stats(struct ble_notify_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2025 Grovety Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/sys/byteorder.h>
+
+#include "bthome.h"
+
+size_t bthome_object_size(uint8_t id)
+{
+	switch (id)
+	{
+	case BTHOME_ID_PACKET_ID:
+	case BTHOME_ID_BATTERY:
+	case BTHOME_ID_COUNT_U8:
+	case BTHOME_ID_BOOLEAN:
+		return 1;
+	case BTHOME_ID_TEMPERATURE:
+	case BTHOME_ID_HUMIDITY:
+	case BTHOME_ID_CO2:
+	case BTHOME_ID_TVOC:
+	case BTHOME_ID_COUNT_U16:
+		return 2;
+	case BTHOME_ID_PRESSURE:
+		return 3;
+	default:
+		return 0;
+	}
+}
+
+static size_t put_object(uint8_t *buf, size_t size, uint8_t id, uint32_t value)
+{
+	size_t len = bthome_object_size(id);
+
+	if (len == 0 || 1 + len > size)
+	{
+		return 0;
+	}
+
+	buf[0] = id;
+	for (size_t i = 0; i < len; i++)
+	{
+		buf[1 + i] = (uint8_t)(value >> (8 * i));
+	}
+	return 1 + len;
+}
+
+size_t bthome_encode(uint8_t *buf, size_t size, uint8_t packet_id,
+					 const struct bthome_object *objects, size_t count, size_t *encoded)
+{
+	size_t pos = BTHOME_HEADER_LEN;
+
+	*encoded = 0;
+
+	if (size < BTHOME_HEADER_LEN)
+	{
+		return 0;
+	}
+	sys_put_le16(BTHOME_SERVICE_UUID, buf);
+	buf[2] = BTHOME_DEVICE_INFO;
+
+	size_t len = put_object(&buf[pos], size - pos, BTHOME_ID_PACKET_ID, packet_id);
+	if (len == 0)
+	{
+		return 0;
+	}
+	pos += len;
+
+	/* Stop at the first object that does not fit so the rest can go to
+	 * another frame in the same order.
+	 */
+	for (size_t i = 0; i < count; i++)
+	{
+		len = put_object(&buf[pos], size - pos, objects[i].id, objects[i].value);
+		if (len == 0)
+		{
+			break;
+		}
+		pos += len;
+		(*encoded)++;
+	}
+
+	return pos;
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2025 Grovety Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** BTHome service UUID */
+#define BTHOME_SERVICE_UUID 0xfcd2
+
+/** BTHome device information byte: version 2, not encrypted, regular interval */
+#define BTHOME_DEVICE_INFO 0x40
+
+/** Size of the frame header: service UUID and device information */
+#define BTHOME_HEADER_LEN 3
+
+    /**
+     * @brief BTHome v2 object IDs used by the firmware.
+     */
+    enum bthome_object_id
+    {
+        /** uint8, packet ID used by receivers to drop duplicates */
+        BTHOME_ID_PACKET_ID = 0x00,
+        /** uint8, % */
+        BTHOME_ID_BATTERY = 0x01,
+        /** sint16, 0.01 degrees Celsius */
+        BTHOME_ID_TEMPERATURE = 0x02,
+        /** uint16, 0.01 % */
+        BTHOME_ID_HUMIDITY = 0x03,
+        /** uint24, 0.01 hPa */
+        BTHOME_ID_PRESSURE = 0x04,
+        /** uint8, generic count */
+        BTHOME_ID_COUNT_U8 = 0x09,
+        /** uint8, generic boolean */
+        BTHOME_ID_BOOLEAN = 0x0f,
+        /** uint16, ppm */
+        BTHOME_ID_CO2 = 0x12,
+        /** uint16, ug/m3 */
+        BTHOME_ID_TVOC = 0x13,
+        /** uint16, generic count */
+        BTHOME_ID_COUNT_U16 = 0x3d,
+    };
+
+    /**
+     * @brief One object of a BTHome frame.
+     */
+    struct bthome_object
+    {
+        /** Object ID, one of enum bthome_object_id */
+        uint8_t id;
+        /** Value in the object unit, signed values in two's complement */
+        uint32_t value;
+    };
+
+    /**
+     * @brief Provides the size of an object value.
+     *
+     * @param id Object ID.
+     *
+     * @return Size in bytes, 0 if the ID is not supported.
+     */
+    size_t bthome_object_size(uint8_t id);
+
+    /**
+     * @brief Encodes a BTHome v2 service data frame.
+     *
+     * The frame starts with the packet ID object followed by as many objects
+     * as fit in the buffer. Objects are encoded in the given order, which must
+     * be ascending by ID as the specification requires.
+     *
+     * @param buf Buffer for the service data, including the UUID.
+     * @param size Size of the buffer.
+     * @param packet_id Packet ID to put in the frame.
+     * @param objects Objects to encode.
+     * @param count Number of objects.
+     * @param encoded Number of objects that were encoded.
+     *
+     * @return Length of the frame, 0 if the header does not fit.
+     */
+    size_t bthome_encode(uint8_t *buf, size_t size, uint8_t packet_id,
+                         const struct bthome_object *objects, size_t count, size_t *encoded);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,347 @@
+/*
+ * Copyright (c) 2025 Grovety Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/init.h>
+#include <zephyr/drivers/sensor.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/gatt.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/util.h>
+#if CONFIG_SHELL
+#include <zephyr/shell/shell.h>
+#endif
+#include <drivers/bme68x_iaq_ext.h>
+
+#include "ble.h"
+
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_DECLARE(app, CONFIG_APP_LOG_LEVEL);
+
+/* Length of the offset in front of each written chunk */
+#define CHUNK_OFFSET_LEN 2
+
+static const struct device *const bme_sensor = DEVICE_DT_GET(DT_INST(0, bosch_bme680));
+
+static uint8_t export_buf[BME68X_IAQ_STATE_EXPORT_MAX];
+static uint16_t export_len;
+static uint8_t import_buf[BME68X_IAQ_STATE_EXPORT_MAX];
+static uint16_t import_len;
+static K_MUTEX_DEFINE(calibration_mutex);
+
+static int calibration_export(void)
+{
+	int ret = bme68x_iaq_export_state(bme_sensor, export_buf, sizeof(export_buf));
+	if (ret < 0)
+	{
+		LOG_ERR("Failed to export the BSEC state (err %d)", ret);
+		export_len = 0;
+		return ret;
+	}
+	export_len = ret;
+	return 0;
+}
+
+/* Collects the chunks of a state, and imports it once complete. Returns
+ * -EINPROGRESS while more chunks are expected.
+ */
+static int calibration_import(uint16_t offset, const uint8_t *data, size_t len)
+{
+	struct bme68x_iaq_state_header header;
+	size_t total;
+	int err;
+
+	if (offset == 0)
+	{
+		import_len = 0;
+	}
+	if (offset != import_len || len > sizeof(import_buf) - import_len)
+	{
+		return -EINVAL;
+	}
+	memcpy(&import_buf[import_len], data, len);
+	import_len += len;
+
+	if (import_len < sizeof(header))
+	{
+		return -EINPROGRESS;
+	}
+	memcpy(&header, import_buf, sizeof(header));
+	total = sizeof(header) + sys_le16_to_cpu(header.len);
+	if (total > sizeof(import_buf) || import_len > total)
+	{
+		import_len = 0;
+		return -EINVAL;
+	}
+	if (import_len < total)
+	{
+		return -EINPROGRESS;
+	}
+
+	err = bme68x_iaq_import_state(bme_sensor, import_buf, import_len);
+	import_len = 0;
+	if (err)
+	{
+		LOG_ERR("Failed to import the BSEC state (err %d)", err);
+	}
+	return err;
+}
+
+/* The state is exported when it is read from the start, and the rest of a
+ * long read comes from the same export.
+ */
+static ssize_t read_calibration(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+								void *buf, uint16_t len, uint16_t offset)
+{
+	ssize_t ret;
+
+	k_mutex_lock(&calibration_mutex, K_FOREVER);
+	if (offset == 0 && calibration_export())
+	{
+		k_mutex_unlock(&calibration_mutex);
+		return BT_GATT_ERR(BT_ATT_ERR_UNLIKELY);
+	}
+	ret = bt_gatt_attr_read(conn, attr, buf, len, offset, export_buf, export_len);
+	k_mutex_unlock(&calibration_mutex);
+	return ret;
+}
+
+/* Each write holds the little endian offset of its chunk in the state,
+ * followed by the chunk. The state is imported with its last chunk.
+ */
+static ssize_t write_calibration(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+								 const void *buf, uint16_t len, uint16_t offset, uint8_t flags)
+{
+	const uint8_t *data = buf;
+	int err;
+
+	ARG_UNUSED(conn);
+	ARG_UNUSED(attr);
+	ARG_UNUSED(flags);
+
+	if (offset != 0)
+	{
+		return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
+	}
+	if (len <= CHUNK_OFFSET_LEN)
+	{
+		return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+	}
+
+	k_mutex_lock(&calibration_mutex, K_FOREVER);
+	err = calibration_import(sys_get_le16(data), data + CHUNK_OFFSET_LEN, len - CHUNK_OFFSET_LEN);
+	k_mutex_unlock(&calibration_mutex);
+
+	if (err && err != -EINPROGRESS)
+	{
+		return BT_GATT_ERR(BT_ATT_ERR_VALUE_NOT_ALLOWED);
+	}
+	return len;
+}
+
+/* The calibration state sets every reading of the sensor, so it needs a
+ * link paired with the passkey, Just Works pairing is not protected against
+ * a man in the middle.
+ */
+BT_GATT_SERVICE_DEFINE(calibration_svc,
+					   BT_GATT_PRIMARY_SERVICE(BT_UUID_CALIBRATION_SERVICE),
+					   BT_GATT_CHARACTERISTIC(BT_UUID_GATT_CALIBRATION,
+											  BT_GATT_CHRC_READ | BT_GATT_CHRC_WRITE,
+											  BT_GATT_PERM_READ_AUTHEN | BT_GATT_PERM_WRITE_AUTHEN,
+											  read_calibration, write_calibration, NULL), );
+
+/* Displaying the passkey makes the peer enter it, which authenticates the
+ * link. The sensor displays it in its log.
+ */
+static void auth_passkey_display(struct bt_conn *conn, unsigned int passkey)
+{
+	char addr[BT_ADDR_LE_STR_LEN];
+
+	bt_addr_le_to_str(bt_conn_get_dst(conn), addr, sizeof(addr));
+	LOG_INF("Pairing passkey for %s: %06u", addr, passkey);
+}
+
+static void auth_cancel(struct bt_conn *conn)
+{
+	ARG_UNUSED(conn);
+
+	LOG_INF("Pairing cancelled");
+}
+
+static struct bt_conn_auth_cb auth_callbacks = {
+	.passkey_display = auth_passkey_display,
+	.cancel = auth_cancel,
+};
+
+static int calibration_auth_init(void)
+{
+	int err;
+
+#if CONFIG_APP_CALIBRATION_FIXED_PASSKEY
+	err = bt_passkey_set(CONFIG_APP_CALIBRATION_PASSKEY);
+	if (err)
+	{
+		LOG_ERR("Failed to set the pairing passkey (err %d)", err);
+		return err;
+	}
+#endif
+	err = bt_conn_auth_cb_register(&auth_callbacks);
+	if (err)
+	{
+		LOG_ERR("Failed to register the pairing callbacks (err %d)", err);
+	}
+	return err;
+}
+
+SYS_INIT(calibration_auth_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
+
+#if CONFIG_SHELL
+/* Bytes per line of the export, short enough for the shell line buffer */
+#define SHELL_CHUNK_SIZE 32
+
+static int cmd_export(const struct shell *sh, size_t argc, char **argv)
+{
+	char hex[SHELL_CHUNK_SIZE * 2 + 1];
+	int err;
+
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	k_mutex_lock(&calibration_mutex, K_FOREVER);
+	err = calibration_export();
+	if (err)
+	{
+		k_mutex_unlock(&calibration_mutex);
+		shell_error(sh, "Export failed (err %d)", err);
+		return err;
+	}
+
+	/* Printed as the commands importing it on another sensor */
+	for (uint16_t offset = 0; offset < export_len; offset += SHELL_CHUNK_SIZE)
+	{
+		size_t len = MIN(SHELL_CHUNK_SIZE, export_len - offset);
+
+		bin2hex(&export_buf[offset], len, hex, sizeof(hex));
+		shell_print(sh, "bsec import %u %s", offset, hex);
+	}
+	k_mutex_unlock(&calibration_mutex);
+	return 0;
+}
+
+static int cmd_import(const struct shell *sh, size_t argc, char **argv)
+{
+	uint8_t chunk[SHELL_CHUNK_SIZE];
+	char *end;
+	unsigned long offset = strtoul(argv[1], &end, 0);
+	size_t len = hex2bin(argv[2], strlen(argv[2]), chunk, sizeof(chunk));
+	int err;
+
+	ARG_UNUSED(argc);
+
+	if (*end != '\0' || offset > UINT16_MAX || len == 0)
+	{
+		shell_error(sh, "Invalid offset or data");
+		return -EINVAL;
+	}
+
+	k_mutex_lock(&calibration_mutex, K_FOREVER);
+	err = calibration_import(offset, chunk, len);
+	k_mutex_unlock(&calibration_mutex);
+
+	if (err == -EINPROGRESS)
+	{
+		return 0;
+	}
+	if (err)
+	{
+		shell_error(sh, "Import failed (err %d)", err);
+		return err;
+	}
+	shell_print(sh, "BSEC state imported");
+	return 0;
+}
+
+static int cmd_save(const struct shell *sh, size_t argc, char **argv)
+{
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	int err = bme68x_iaq_save_state(bme_sensor);
+	if (err)
+	{
+		shell_error(sh, "Save failed (err %d)", err);
+	}
+	return err;
+}
+
+/* Names of enum bme68x_iaq_sample_rate */
+static const char *const rate_names[] = {
+	[BME68X_IAQ_SAMPLE_RATE_ULTRA_LOW_POWER] = "ulp",
+	[BME68X_IAQ_SAMPLE_RATE_LOW_POWER] = "lp",
+	[BME68X_IAQ_SAMPLE_RATE_CONTINUOUS] = "cont",
+	[BME68X_IAQ_SAMPLE_RATE_QUICK_ULTRA_LOW_POWER] = "qulp",
+};
+
+/* Prints the stored sample mode, or stores a new one. With adaptive
+ * sampling, it is the mode of the normal level and bounds the others.
+ */
+static int cmd_rate(const struct shell *sh, size_t argc, char **argv)
+{
+	struct sensor_value value = {0};
+	size_t rate = 0;
+	int err;
+
+	if (argc == 1)
+	{
+		err = sensor_attr_get(bme_sensor, SENSOR_CHAN_ALL,
+							  (enum sensor_attribute)SENSOR_ATTR_BME68X_IAQ_SAMPLE_RATE, &value);
+		if (err || value.val1 < 0 || (size_t)value.val1 >= ARRAY_SIZE(rate_names))
+		{
+			shell_error(sh, "Reading the sample mode failed (err %d)", err);
+			return err ? err : -EIO;
+		}
+		shell_print(sh, "%s", rate_names[value.val1]);
+		return 0;
+	}
+
+	while (rate < ARRAY_SIZE(rate_names) && strcmp(argv[1], rate_names[rate]) != 0)
+	{
+		rate++;
+	}
+	if (rate == ARRAY_SIZE(rate_names))
+	{
+		shell_error(sh, "Unknown sample mode %s", argv[1]);
+		return -EINVAL;
+	}
+	value.val1 = rate;
+
+	err = sensor_attr_set(bme_sensor, SENSOR_CHAN_ALL,
+						  (enum sensor_attribute)SENSOR_ATTR_BME68X_IAQ_SAMPLE_RATE, &value);
+	if (err)
+	{
+		shell_error(sh, "Storing the sample mode failed (err %d)", err);
+	}
+	return err;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(bsec_cmds,
+							   SHELL_CMD_ARG(export, NULL, "Print the BSEC state as import commands",
+											 cmd_export, 1, 0),
+							   SHELL_CMD_ARG(import, NULL, "Import a chunk of a BSEC state: <offset> <hex>",
+											 cmd_import, 3, 0),
+							   SHELL_CMD_ARG(save, NULL, "Save the BSEC state to flash now",
+											 cmd_save, 1, 0),
+							   SHELL_CMD_ARG(rate, NULL, "Print or store the sample mode: [ulp|qulp|lp|cont]",
+											 cmd_rate, 1, 1),
+							   SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(bsec, &bsec_cmds, "BSEC calibration state and sample mode", NULL);
+#endif /* CONFIG_SHELL */
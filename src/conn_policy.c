@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2025 Grovety Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/conn.h>
+
+#include "conn_policy.h"
+
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_DECLARE(app, CONFIG_APP_LOG_LEVEL);
+
+/* Connection interval unit is 1.25 ms, supervision timeout unit is 10 ms */
+#define INTERVAL_UNITS(ms) ((ms) * 4 / 5)
+#define TIMEOUT_UNITS(ms) ((ms) / 10)
+
+/* Long interval with latency while the central only gets notifications */
+static const struct bt_le_conn_param idle_param = BT_LE_CONN_PARAM_INIT(
+	INTERVAL_UNITS(CONFIG_APP_CONN_IDLE_INTERVAL_MS),
+	INTERVAL_UNITS(CONFIG_APP_CONN_IDLE_INTERVAL_MS) + INTERVAL_UNITS(100),
+	CONFIG_APP_CONN_IDLE_LATENCY, TIMEOUT_UNITS(CONFIG_APP_CONN_IDLE_TIMEOUT_MS));
+
+/* 15 ms to 30 ms without latency for bulk transfers */
+static const struct bt_le_conn_param bulk_param =
+	BT_LE_CONN_PARAM_INIT(INTERVAL_UNITS(15), INTERVAL_UNITS(30), 0, TIMEOUT_UNITS(4000));
+
+BUILD_ASSERT(CONFIG_APP_CONN_IDLE_TIMEOUT_MS >
+				 2 * (1 + CONFIG_APP_CONN_IDLE_LATENCY) * (CONFIG_APP_CONN_IDLE_INTERVAL_MS + 100),
+			 "Supervision timeout too short for the idle interval and latency");
+
+struct conn_state
+{
+	struct bt_conn *conn;
+	struct k_work_delayable idle_work;
+	bool bulk;
+};
+
+static struct conn_state conn_states[CONFIG_BT_MAX_CONN];
+static atomic_t conn_count;
+
+static int request_param(struct conn_state *state, const struct bt_le_conn_param *param)
+{
+	int err = bt_conn_le_param_update(state->conn, param);
+	if (err && err != -EALREADY)
+	{
+		LOG_WRN("Failed to request connection parameters (err %d)", err);
+		return err;
+	}
+	return 0;
+}
+
+static void idle_work_handler(struct k_work *work)
+{
+	struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+	struct conn_state *state = CONTAINER_OF(dwork, struct conn_state, idle_work);
+
+	if (state->conn && !state->bulk)
+	{
+		request_param(state, &idle_param);
+	}
+}
+
+void conn_policy_connected(struct bt_conn *conn)
+{
+	struct conn_state *state = &conn_states[bt_conn_index(conn)];
+
+	state->conn = bt_conn_ref(conn);
+	state->bulk = false;
+	k_work_init_delayable(&state->idle_work, idle_work_handler);
+	k_work_schedule(&state->idle_work, K_SECONDS(CONFIG_APP_CONN_IDLE_DELAY_SEC));
+	atomic_inc(&conn_count);
+}
+
+void conn_policy_disconnected(struct bt_conn *conn)
+{
+	struct conn_state *state = &conn_states[bt_conn_index(conn)];
+
+	if (!state->conn)
+	{
+		return;
+	}
+
+	k_work_cancel_delayable(&state->idle_work);
+	bt_conn_unref(state->conn);
+	state->conn = NULL;
+	atomic_dec(&conn_count);
+}
+
+int conn_policy_bulk_begin(struct bt_conn *conn)
+{
+	struct conn_state *state = &conn_states[bt_conn_index(conn)];
+
+	if (!state->conn)
+	{
+		return -ENOTCONN;
+	}
+
+	state->bulk = true;
+	k_work_cancel_delayable(&state->idle_work);
+
+	int err = request_param(state, &bulk_param);
+	if (err)
+	{
+		return err;
+	}
+
+	/* The PHY and data length are best effort, the transfer works without */
+	err = bt_conn_le_phy_update(conn, BT_CONN_LE_PHY_PARAM_2M);
+	if (err)
+	{
+		LOG_WRN("Failed to request the 2M PHY (err %d)", err);
+	}
+	err = bt_conn_le_data_len_update(conn, BT_LE_DATA_LEN_PARAM_MAX);
+	if (err)
+	{
+		LOG_WRN("Failed to request the data length (err %d)", err);
+	}
+	return 0;
+}
+
+int conn_policy_bulk_end(struct bt_conn *conn)
+{
+	struct conn_state *state = &conn_states[bt_conn_index(conn)];
+
+	if (!state->conn)
+	{
+		return -ENOTCONN;
+	}
+
+	/* The 2M PHY and the data length are kept, they shorten the radio time
+	 * of every notification.
+	 */
+	state->bulk = false;
+	return request_param(state, &idle_param);
+}
+
+int conn_policy_count(void)
+{
+	return (int)atomic_get(&conn_count);
+}
+
+static void le_param_updated(struct bt_conn *conn, uint16_t interval, uint16_t latency,
+							 uint16_t timeout)
+{
+	ARG_UNUSED(conn);
+	LOG_DBG("Connection interval %u, latency %u, timeout %u", interval, latency, timeout);
+}
+
+static void le_phy_updated(struct bt_conn *conn, struct bt_conn_le_phy_info *param)
+{
+	ARG_UNUSED(conn);
+	LOG_DBG("PHY tx %u, rx %u", param->tx_phy, param->rx_phy);
+}
+
+static void le_data_len_updated(struct bt_conn *conn, struct bt_conn_le_data_len_info *info)
+{
+	ARG_UNUSED(conn);
+	LOG_DBG("Data length tx %u, rx %u", info->tx_max_len, info->rx_max_len);
+}
+
+BT_CONN_CB_DEFINE(conn_policy_callbacks) = {
+	.le_param_updated = le_param_updated,
+	.le_phy_updated = le_phy_updated,
+	.le_data_len_updated = le_data_len_updated,
+};
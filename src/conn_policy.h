@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2025 Grovety Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <zephyr/bluetooth/conn.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief Starts tracking a new connection. The idle connection parameters
+     *  are requested after CONFIG_APP_CONN_IDLE_DELAY_SEC, once the central
+     *  is done with service discovery.
+     *
+     * @param conn New connection.
+     */
+    void conn_policy_connected(struct bt_conn *conn);
+
+    /**
+     * @brief Stops tracking a connection.
+     *
+     * @param conn Disconnected connection.
+     */
+    void conn_policy_disconnected(struct bt_conn *conn);
+
+    /**
+     * @brief Switches a connection to a short interval, the 2M PHY and the
+     *  largest data length for a bulk transfer.
+     *
+     * @param conn Connection of the transfer.
+     *
+     * @return 0 if success, error code if failure.
+     */
+    int conn_policy_bulk_begin(struct bt_conn *conn);
+
+    /**
+     * @brief Returns a connection to the idle connection parameters after a
+     *  bulk transfer.
+     *
+     * @param conn Connection of the transfer.
+     *
+     * @return 0 if success, error code if failure.
+     */
+    int conn_policy_bulk_end(struct bt_conn *conn);
+
+    /**
+     * @brief Provides the number of connections.
+     *
+     * @return Number of established connections.
+     */
+    int conn_policy_count(void);
+
+#ifdef __cplusplus
+}
+#endif
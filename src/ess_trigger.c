@@ -0,0 +1,178 @@
+/*
+ * Copyright (c) 2025 Grovety Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+
+#include <zephyr/sys/byteorder.h>
+
+#include "ess_trigger.h"
+
+#define INTERVAL_SIZE 3
+
+static int32_t get_value(const uint8_t *buf, size_t size, bool is_signed)
+{
+	switch (size)
+	{
+	case 1:
+		return is_signed ? (int8_t)buf[0] : buf[0];
+	case 2:
+		return is_signed ? (int16_t)sys_get_le16(buf) : sys_get_le16(buf);
+	default:
+		return (int32_t)sys_get_le32(buf);
+	}
+}
+
+static void put_value(int32_t value, uint8_t *buf, size_t size)
+{
+	switch (size)
+	{
+	case 1:
+		buf[0] = (uint8_t)value;
+		break;
+	case 2:
+		sys_put_le16((uint16_t)value, buf);
+		break;
+	default:
+		sys_put_le32((uint32_t)value, buf);
+		break;
+	}
+}
+
+int ess_trigger_decode(struct ess_trigger *trigger, const uint8_t *buf, size_t len,
+					   size_t value_size, bool is_signed)
+{
+	if (len < 1)
+	{
+		return -EINVAL;
+	}
+
+	uint8_t condition = buf[0];
+
+	switch (condition)
+	{
+	case ESS_TRIGGER_INACTIVE:
+		if (len != 1)
+		{
+			return -EINVAL;
+		}
+		trigger->operand = 0;
+		break;
+
+	case ESS_TRIGGER_FIXED_INTERVAL:
+	case ESS_TRIGGER_MIN_INTERVAL:
+		if (len != 1 + INTERVAL_SIZE)
+		{
+			return -EINVAL;
+		}
+		trigger->operand = (int32_t)sys_get_le24(&buf[1]);
+		break;
+
+	case ESS_TRIGGER_VALUE_CHANGED:
+		/* The standard condition has no operand, any change is notified */
+		if (len == 1)
+		{
+			trigger->operand = 0;
+			break;
+		}
+		__fallthrough;
+
+	case ESS_TRIGGER_LESS_THAN:
+	case ESS_TRIGGER_LESS_OR_EQUAL:
+	case ESS_TRIGGER_GREATER_THAN:
+	case ESS_TRIGGER_GREATER_OR_EQUAL:
+	case ESS_TRIGGER_EQUAL:
+	case ESS_TRIGGER_NOT_EQUAL:
+		if (len != 1 + value_size)
+		{
+			return -EINVAL;
+		}
+		trigger->operand = get_value(&buf[1], value_size, is_signed);
+		break;
+
+	default:
+		return -ENOTSUP;
+	}
+
+	trigger->condition = condition;
+	return 0;
+}
+
+size_t ess_trigger_encode(const struct ess_trigger *trigger, uint8_t *buf, size_t value_size)
+{
+	buf[0] = trigger->condition;
+
+	switch (trigger->condition)
+	{
+	case ESS_TRIGGER_INACTIVE:
+		return 1;
+
+	case ESS_TRIGGER_FIXED_INTERVAL:
+	case ESS_TRIGGER_MIN_INTERVAL:
+		sys_put_le24((uint32_t)trigger->operand, &buf[1]);
+		return 1 + INTERVAL_SIZE;
+
+	case ESS_TRIGGER_VALUE_CHANGED:
+		if (trigger->operand == 0)
+		{
+			return 1;
+		}
+		__fallthrough;
+
+	default:
+		put_value(trigger->operand, &buf[1], value_size);
+		return 1 + value_size;
+	}
+}
+
+bool ess_trigger_check(const struct ess_trigger *trigger, const struct ess_trigger_state *state,
+					   int32_t value, int64_t now_ms)
+{
+	int64_t elapsed_ms = now_ms - state->last_sent_ms;
+	bool changed = !state->has_sent || value != state->last_sent;
+
+	switch (trigger->condition)
+	{
+	case ESS_TRIGGER_FIXED_INTERVAL:
+		return !state->has_sent || elapsed_ms >= (int64_t)trigger->operand * 1000;
+
+	case ESS_TRIGGER_MIN_INTERVAL:
+		return changed && (!state->has_sent || elapsed_ms >= (int64_t)trigger->operand * 1000);
+
+	case ESS_TRIGGER_VALUE_CHANGED:
+		/* Compared to the last value sent, so slow drifts still get through */
+		return changed && (!state->has_sent ||
+						   llabs((int64_t)value - state->last_sent) >= trigger->operand);
+
+	case ESS_TRIGGER_LESS_THAN:
+		return changed && value < trigger->operand;
+
+	case ESS_TRIGGER_LESS_OR_EQUAL:
+		return changed && value <= trigger->operand;
+
+	case ESS_TRIGGER_GREATER_THAN:
+		return changed && value > trigger->operand;
+
+	case ESS_TRIGGER_GREATER_OR_EQUAL:
+		return changed && value >= trigger->operand;
+
+	case ESS_TRIGGER_EQUAL:
+		return changed && value == trigger->operand;
+
+	case ESS_TRIGGER_NOT_EQUAL:
+		return changed && value != trigger->operand;
+
+	default:
+		return false;
+	}
+}
+
+void ess_trigger_sent(struct ess_trigger_state *state, int32_t value, int64_t now_ms)
+{
+	state->last_sent = value;
+	state->last_sent_ms = now_ms;
+	state->has_sent = true;
+}
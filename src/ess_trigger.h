@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2025 Grovety Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** Largest encoded ES Trigger Setting: the condition and a 32 bit operand */
+#define ESS_TRIGGER_MAX_LEN 5
+
+    /**
+     * @brief ES Trigger Setting conditions.
+     */
+    enum ess_trigger_condition
+    {
+        /** Never notify. */
+        ESS_TRIGGER_INACTIVE = 0x00,
+        /** Notify at a fixed interval, operand in seconds. */
+        ESS_TRIGGER_FIXED_INTERVAL = 0x01,
+        /** Notify changes, no more often than the operand, in seconds. */
+        ESS_TRIGGER_MIN_INTERVAL = 0x02,
+        /**
+         * Notify changes. As an extension the operand, in the characteristic
+         * format, is the smallest change notified. It is optional on write.
+         */
+        ESS_TRIGGER_VALUE_CHANGED = 0x03,
+        /** Notify changes while the value is below the operand. */
+        ESS_TRIGGER_LESS_THAN = 0x04,
+        /** Notify changes while the value is below or equal to the operand. */
+        ESS_TRIGGER_LESS_OR_EQUAL = 0x05,
+        /** Notify changes while the value is above the operand. */
+        ESS_TRIGGER_GREATER_THAN = 0x06,
+        /** Notify changes while the value is above or equal to the operand. */
+        ESS_TRIGGER_GREATER_OR_EQUAL = 0x07,
+        /** Notify when the value becomes equal to the operand. */
+        ESS_TRIGGER_EQUAL = 0x08,
+        /** Notify changes while the value differs from the operand. */
+        ESS_TRIGGER_NOT_EQUAL = 0x09,
+    };
+
+    /**
+     * @brief One ES Trigger Setting.
+     */
+    struct ess_trigger
+    {
+        /** One of enum ess_trigger_condition. */
+        uint8_t condition;
+        /** Seconds for the interval conditions, a characteristic value otherwise. */
+        int32_t operand;
+    };
+
+    /**
+     * @brief What was last sent to a client for one characteristic.
+     */
+    struct ess_trigger_state
+    {
+        int64_t last_sent_ms;
+        int32_t last_sent;
+        bool has_sent;
+    };
+
+    /**
+     * @brief Decodes a written ES Trigger Setting.
+     *
+     * @param trigger Decoded trigger.
+     * @param buf Written value.
+     * @param len Length of the written value.
+     * @param value_size Size of the characteristic value.
+     * @param is_signed true if the characteristic value is signed.
+     *
+     * @return 0 if success, -EINVAL if the length is wrong, -ENOTSUP if the
+     *  condition is not supported.
+     */
+    int ess_trigger_decode(struct ess_trigger *trigger, const uint8_t *buf, size_t len,
+                           size_t value_size, bool is_signed);
+
+    /**
+     * @brief Encodes an ES Trigger Setting for reading.
+     *
+     * @param trigger Trigger to encode.
+     * @param buf Buffer of at least ESS_TRIGGER_MAX_LEN bytes.
+     * @param value_size Size of the characteristic value.
+     *
+     * @return Encoded length.
+     */
+    size_t ess_trigger_encode(const struct ess_trigger *trigger, uint8_t *buf, size_t value_size);
+
+    /**
+     * @brief Checks if a value must be sent to a client.
+     *
+     * @param trigger Trigger configured by the client.
+     * @param state What was last sent to the client.
+     * @param value Current characteristic value.
+     * @param now_ms Current time, in milliseconds.
+     *
+     * @return true if the value must be sent.
+     */
+    bool ess_trigger_check(const struct ess_trigger *trigger, const struct ess_trigger_state *state,
+                           int32_t value, int64_t now_ms);
+
+    /**
+     * @brief Records that a value was sent to a client.
+     *
+     * @param state State to update.
+     * @param value Value sent.
+     * @param now_ms Current time, in milliseconds.
+     */
+    void ess_trigger_sent(struct ess_trigger_state *state, int32_t value, int64_t now_ms);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,444 @@
+/*
+ * Copyright (c) 2025 Grovety Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#if CONFIG_SHELL
+#include <zephyr/shell/shell.h>
+#endif
+
+#include "history.h"
+
+#define BLOCK_SIZE CONFIG_APP_HISTORY_BLOCK_SIZE
+#define BLOCK_COUNT (CONFIG_APP_HISTORY_SIZE / CONFIG_APP_HISTORY_BLOCK_SIZE)
+
+/* No XOR window yet, the next non-zero XOR sends its own */
+#define NO_WINDOW UINT8_MAX
+
+/* Worst case sample: a 10 byte timestamp varint, and per value a 2 bit
+ * control, 5 bit leading zero count, 5 bit length and 32 meaningful bits.
+ * The first sample of a block is raw: a 64 bit timestamp and 32 bit values.
+ */
+#define SAMPLE_MAX_BITS MAX(10 * 8 + HISTORY_CHANNEL_COUNT * (2 + 5 + 5 + 32), \
+							64 + HISTORY_CHANNEL_COUNT * 32)
+
+BUILD_ASSERT(BLOCK_COUNT >= 2, "History needs at least two blocks");
+BUILD_ASSERT(BLOCK_SIZE * 8 <= UINT16_MAX, "History block too large");
+BUILD_ASSERT(BLOCK_SIZE * 8 >= SAMPLE_MAX_BITS, "History block too small");
+
+/* Blocks can be decoded on their own, so the oldest one can be dropped in
+ * constant time when the history is full.
+ */
+struct history_block
+{
+	int64_t first_ts;
+	uint32_t seq;
+	uint16_t count;
+	uint16_t bits;
+	uint8_t data[BLOCK_SIZE];
+};
+
+static struct history_block blocks[BLOCK_COUNT];
+/* Sequence number of the block being written, 0 before the first sample */
+static uint32_t head_seq;
+static struct history_codec writer;
+
+static K_MUTEX_DEFINE(history_mutex);
+
+static void put_bits(uint8_t *data, uint16_t *pos, uint32_t value, uint8_t n)
+{
+	for (int i = n - 1; i >= 0; i--)
+	{
+		uint8_t mask = 0x80 >> (*pos % 8);
+
+		if ((value >> i) & 1)
+		{
+			data[*pos / 8] |= mask;
+		}
+		else
+		{
+			data[*pos / 8] &= ~mask;
+		}
+		(*pos)++;
+	}
+}
+
+static uint32_t get_bits(const uint8_t *data, uint16_t *pos, uint8_t n)
+{
+	uint32_t value = 0;
+
+	for (int i = 0; i < n; i++)
+	{
+		value = (value << 1) | ((data[*pos / 8] >> (7 - *pos % 8)) & 1);
+		(*pos)++;
+	}
+	return value;
+}
+
+static void put_varint(uint8_t *data, uint16_t *pos, int64_t value)
+{
+	/* Zigzag, small negative deltas become small positive numbers */
+	uint64_t zz = ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+
+	while (zz >= 0x80)
+	{
+		put_bits(data, pos, (uint32_t)(zz & 0x7f) | 0x80, 8);
+		zz >>= 7;
+	}
+	put_bits(data, pos, (uint32_t)zz, 8);
+}
+
+static int64_t get_varint(const uint8_t *data, uint16_t *pos)
+{
+	uint64_t zz = 0;
+	uint32_t byte;
+	int shift = 0;
+
+	do
+	{
+		byte = get_bits(data, pos, 8);
+		zz |= (uint64_t)(byte & 0x7f) << shift;
+		shift += 7;
+	} while ((byte & 0x80) && shift < 64);
+
+	return (int64_t)(zz >> 1) ^ -(int64_t)(zz & 1);
+}
+
+static uint32_t float_bits(float value)
+{
+	uint32_t bits;
+
+	memcpy(&bits, &value, sizeof(bits));
+	return bits;
+}
+
+static float bits_float(uint32_t bits)
+{
+	float value;
+
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+/* Gorilla XOR encoding: '0' for a repeated value, '10' and the meaningful
+ * bits if they fit the previous window, '11', the window and the bits
+ * otherwise.
+ */
+static void put_xor(uint8_t *data, uint16_t *pos, struct history_channel_state *ch,
+					uint32_t value)
+{
+	uint32_t xor = value ^ ch->prev;
+
+	ch->prev = value;
+
+	if (xor == 0)
+	{
+		put_bits(data, pos, 0, 1);
+		return;
+	}
+
+	uint8_t leading = MIN(__builtin_clz(xor), 31);
+	uint8_t trailing = __builtin_ctz(xor);
+
+	if (ch->leading != NO_WINDOW && leading >= ch->leading && trailing >= ch->trailing)
+	{
+		put_bits(data, pos, 0x2, 2);
+		put_bits(data, pos, xor >> ch->trailing, 32 - ch->leading - ch->trailing);
+		return;
+	}
+
+	uint8_t len = 32 - leading - trailing;
+
+	put_bits(data, pos, 0x3, 2);
+	put_bits(data, pos, leading, 5);
+	put_bits(data, pos, len - 1, 5);
+	put_bits(data, pos, xor >> trailing, len);
+	ch->leading = leading;
+	ch->trailing = trailing;
+}
+
+static uint32_t get_xor(const uint8_t *data, uint16_t *pos, struct history_channel_state *ch)
+{
+	if (get_bits(data, pos, 1) == 0)
+	{
+		return ch->prev;
+	}
+
+	if (get_bits(data, pos, 1) == 1)
+	{
+		uint8_t leading = get_bits(data, pos, 5);
+		uint8_t len = get_bits(data, pos, 5) + 1;
+
+		ch->leading = leading;
+		ch->trailing = 32 - leading - len;
+	}
+
+	uint32_t xor = get_bits(data, pos, 32 - ch->leading - ch->trailing) << ch->trailing;
+
+	ch->prev ^= xor;
+	return ch->prev;
+}
+
+static void encode(struct history_codec *codec, uint8_t *data, uint16_t *pos,
+				   const struct history_sample *sample, bool first)
+{
+	if (first)
+	{
+		put_bits(data, pos, (uint32_t)((uint64_t)sample->timestamp_ms >> 32), 32);
+		put_bits(data, pos, (uint32_t)sample->timestamp_ms, 32);
+		codec->prev_ts = sample->timestamp_ms;
+		codec->prev_delta = 0;
+
+		for (int i = 0; i < HISTORY_CHANNEL_COUNT; i++)
+		{
+			codec->channels[i].prev = float_bits(sample->values[i]);
+			codec->channels[i].leading = NO_WINDOW;
+			put_bits(data, pos, codec->channels[i].prev, 32);
+		}
+		return;
+	}
+
+	/* Samples come at a steady period, so the delta of deltas is close to 0 */
+	int64_t delta = sample->timestamp_ms - codec->prev_ts;
+
+	put_varint(data, pos, delta - codec->prev_delta);
+	codec->prev_ts = sample->timestamp_ms;
+	codec->prev_delta = delta;
+
+	for (int i = 0; i < HISTORY_CHANNEL_COUNT; i++)
+	{
+		put_xor(data, pos, &codec->channels[i], float_bits(sample->values[i]));
+	}
+}
+
+static void decode(struct history_codec *codec, const uint8_t *data, uint16_t *pos,
+				   struct history_sample *sample, bool first)
+{
+	if (first)
+	{
+		uint64_t ts = (uint64_t)get_bits(data, pos, 32) << 32;
+
+		ts |= get_bits(data, pos, 32);
+		codec->prev_ts = (int64_t)ts;
+		codec->prev_delta = 0;
+
+		for (int i = 0; i < HISTORY_CHANNEL_COUNT; i++)
+		{
+			codec->channels[i].prev = get_bits(data, pos, 32);
+			codec->channels[i].leading = NO_WINDOW;
+		}
+	}
+	else
+	{
+		codec->prev_delta += get_varint(data, pos);
+		codec->prev_ts += codec->prev_delta;
+
+		for (int i = 0; i < HISTORY_CHANNEL_COUNT; i++)
+		{
+			get_xor(data, pos, &codec->channels[i]);
+		}
+	}
+
+	sample->timestamp_ms = codec->prev_ts;
+	for (int i = 0; i < HISTORY_CHANNEL_COUNT; i++)
+	{
+		sample->values[i] = bits_float(codec->channels[i].prev);
+	}
+}
+
+static uint32_t oldest_seq(void)
+{
+	return head_seq > BLOCK_COUNT ? head_seq - BLOCK_COUNT + 1 : 1;
+}
+
+void history_append(const struct history_sample *sample)
+{
+	k_mutex_lock(&history_mutex, K_FOREVER);
+
+	struct history_block *block = &blocks[head_seq % BLOCK_COUNT];
+
+	if (head_seq == 0 || block->count == 0 || block->bits + SAMPLE_MAX_BITS > BLOCK_SIZE * 8 ||
+		block->count == UINT16_MAX)
+	{
+		head_seq++;
+		block = &blocks[head_seq % BLOCK_COUNT];
+		block->seq = head_seq;
+		block->first_ts = sample->timestamp_ms;
+		block->count = 0;
+		block->bits = 0;
+	}
+
+	encode(&writer, block->data, &block->bits, sample, block->count == 0);
+	block->count++;
+
+	k_mutex_unlock(&history_mutex);
+}
+
+void history_iter_init(struct history_iter *iter, int64_t since_ms)
+{
+	memset(iter, 0, sizeof(*iter));
+
+	k_mutex_lock(&history_mutex, K_FOREVER);
+
+	/* A block only holds samples older than the first one of the next block */
+	iter->block_seq = oldest_seq();
+	while (iter->block_seq < head_seq &&
+		   blocks[(iter->block_seq + 1) % BLOCK_COUNT].first_ts <= since_ms)
+	{
+		iter->block_seq++;
+	}
+
+	k_mutex_unlock(&history_mutex);
+}
+
+int history_iter_next(struct history_iter *iter, struct history_sample *sample)
+{
+	int err = 0;
+
+	k_mutex_lock(&history_mutex, K_FOREVER);
+
+	if (head_seq == 0)
+	{
+		err = -ENODATA;
+		goto unlock;
+	}
+
+	uint32_t oldest = oldest_seq();
+
+	if (iter->block_seq < oldest)
+	{
+		iter->skipped_blocks += oldest - iter->block_seq;
+		iter->block_seq = oldest;
+		iter->index = 0;
+		iter->bit_pos = 0;
+	}
+
+	struct history_block *block = &blocks[iter->block_seq % BLOCK_COUNT];
+
+	/* Blocks emptied by history_clear() are skipped */
+	while (iter->index >= block->count)
+	{
+		if (iter->block_seq >= head_seq)
+		{
+			err = -ENODATA;
+			goto unlock;
+		}
+		iter->block_seq++;
+		iter->index = 0;
+		iter->bit_pos = 0;
+		block = &blocks[iter->block_seq % BLOCK_COUNT];
+	}
+
+	decode(&iter->codec, block->data, &iter->bit_pos, sample, iter->index == 0);
+	iter->index++;
+
+unlock:
+	k_mutex_unlock(&history_mutex);
+	return err;
+}
+
+uint32_t history_iter_block(const struct history_iter *iter)
+{
+	return iter->block_seq;
+}
+
+void history_clear(void)
+{
+	k_mutex_lock(&history_mutex, K_FOREVER);
+
+	/* Readers see the blocks they were reading as overwritten */
+	for (int i = 0; i < BLOCK_COUNT; i++)
+	{
+		blocks[i].count = 0;
+	}
+	head_seq += BLOCK_COUNT;
+
+	k_mutex_unlock(&history_mutex);
+}
+
+void history_get_usage(struct history_usage *usage)
+{
+	memset(usage, 0, sizeof(*usage));
+
+	k_mutex_lock(&history_mutex, K_FOREVER);
+
+	for (uint32_t seq = oldest_seq(); head_seq != 0 && seq <= head_seq; seq++)
+	{
+		const struct history_block *block = &blocks[seq % BLOCK_COUNT];
+
+		if (block->count > 0)
+		{
+			usage->samples += block->count;
+			usage->bits += block->bits;
+			usage->blocks++;
+		}
+	}
+
+	k_mutex_unlock(&history_mutex);
+}
+
+#if CONFIG_SHELL
+static int cmd_dump(const struct shell *sh, size_t argc, char **argv)
+{
+	struct history_iter iter;
+	struct history_sample sample;
+	int64_t since_ms = 0;
+	uint32_t count = 0;
+
+	if (argc > 1)
+	{
+		char *end;
+
+		since_ms = strtoll(argv[1], &end, 0);
+		if (*end != '\0')
+		{
+			shell_error(sh, "Invalid time");
+			return -EINVAL;
+		}
+	}
+
+	history_iter_init(&iter, since_ms);
+	while (history_iter_next(&iter, &sample) == 0)
+	{
+		if (sample.timestamp_ms < since_ms)
+		{
+			continue;
+		}
+		shell_print(sh, "%lld: T %.2f H %.2f P %.0f CO2 %.0f VOC %.2f IAQ %.0f",
+					(long long)sample.timestamp_ms,
+					(double)sample.values[HISTORY_TEMPERATURE],
+					(double)sample.values[HISTORY_HUMIDITY],
+					(double)sample.values[HISTORY_PRESSURE],
+					(double)sample.values[HISTORY_CO2],
+					(double)sample.values[HISTORY_VOC],
+					(double)sample.values[HISTORY_IAQ]);
+		count++;
+	}
+	shell_print(sh, "%u samples, %u blocks overwritten while reading", count,
+				iter.skipped_blocks);
+	return 0;
+}
+
+static int cmd_clear(const struct shell *sh, size_t argc, char **argv)
+{
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	history_clear();
+	shell_print(sh, "History cleared");
+	return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(history_cmds,
+							   SHELL_CMD_ARG(dump, NULL, "Print the samples: [since uptime ms]",
+											 cmd_dump, 1, 1),
+							   SHELL_CMD_ARG(clear, NULL, "Drop all the samples", cmd_clear, 1, 0),
+							   SHELL_SUBCMD_SET_END);
+
+SHELL_CMD_REGISTER(history, &history_cmds, "Sample history", NULL);
+#endif /* CONFIG_SHELL */
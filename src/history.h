@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2025 Grovety Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief Channels stored in the history.
+     */
+    enum history_channel
+    {
+        HISTORY_TEMPERATURE,
+        HISTORY_HUMIDITY,
+        HISTORY_PRESSURE,
+        HISTORY_CO2,
+        HISTORY_VOC,
+        HISTORY_IAQ,
+        HISTORY_CHANNEL_COUNT,
+    };
+
+    /**
+     * @brief One sample of every channel.
+     */
+    struct history_sample
+    {
+        /** System uptime in milliseconds at which the sample was measured. */
+        int64_t timestamp_ms;
+        /** Values, indexed by enum history_channel. */
+        float values[HISTORY_CHANNEL_COUNT];
+    };
+
+    /**
+     * @brief Decoder state of one channel. Fields are private.
+     */
+    struct history_channel_state
+    {
+        uint32_t prev;
+        uint8_t leading;
+        uint8_t trailing;
+    };
+
+    /**
+     * @brief Encoder or decoder state of a block. Fields are private.
+     */
+    struct history_codec
+    {
+        int64_t prev_ts;
+        int64_t prev_delta;
+        struct history_channel_state channels[HISTORY_CHANNEL_COUNT];
+    };
+
+    /**
+     * @brief Streaming reader of the history. Fields are private, except
+     *  skipped_blocks.
+     */
+    struct history_iter
+    {
+        uint32_t block_seq;
+        uint16_t index;
+        uint16_t bit_pos;
+        struct history_codec codec;
+        /** Blocks overwritten by new samples before they were read. */
+        uint32_t skipped_blocks;
+    };
+
+    /**
+     * @brief Appends a sample to the history, overwriting the oldest block of
+     *  samples when the history is full.
+     *
+     * Timestamps are delta-of-delta encoded as zigzag varints and values are
+     * XOR encoded against the previous value of the channel, so a sample
+     * takes a fraction of its raw size. Takes constant time.
+     *
+     * @param sample Sample to append. Timestamps must not go backwards.
+     */
+    void history_append(const struct history_sample *sample);
+
+    /**
+     * @brief Starts reading the history.
+     *
+     * @param iter Iterator to initialize.
+     * @param since_ms Skip the blocks that only hold samples older than this.
+     *  The first samples returned may still be older.
+     */
+    void history_iter_init(struct history_iter *iter, int64_t since_ms);
+
+    /**
+     * @brief Reads the next sample, oldest first.
+     *
+     * If the block being read was overwritten in the meantime, reading
+     * continues with the oldest block still stored and skipped_blocks is
+     * incremented.
+     *
+     * @param iter Iterator.
+     * @param sample Sample read.
+     *
+     * @return 0 if a sample was read, -ENODATA if there are no more samples.
+     */
+    int history_iter_next(struct history_iter *iter, struct history_sample *sample);
+
+    /**
+     * @brief Provides the sequence number of the block the iterator reads
+     *  next. Blocks are numbered in the order they were started.
+     *
+     * @param iter Iterator.
+     *
+     * @return Block sequence number.
+     */
+    uint32_t history_iter_block(const struct history_iter *iter);
+
+    /**
+     * @brief Drops all the samples of the history.
+     */
+    void history_clear(void);
+
+    /**
+     * @brief Space taken by the samples of the history.
+     */
+    struct history_usage
+    {
+        /** Samples stored. */
+        uint32_t samples;
+        /** Bits they take once encoded. */
+        uint32_t bits;
+        /** Blocks holding them. */
+        uint32_t blocks;
+    };
+
+    /**
+     * @brief Provides the space taken by the samples of the history.
+     *
+     * @param usage Space taken.
+     */
+    void history_get_usage(struct history_usage *usage);
+
+#ifdef __cplusplus
+}
+#endif
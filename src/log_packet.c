@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2025 Grovety Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/sys/byteorder.h>
+
+#include "log_packet.h"
+#include "log_transfer.h"
+
+#define RECORD_SIZE sizeof(struct telemetry_record)
+
+int log_packet_fill(struct telemetry_log_iter *iter, uint32_t *skip, uint32_t offset,
+					uint8_t *packet, uint16_t max_records, bool *end_of_log)
+{
+	struct telemetry_record record;
+	uint16_t records = 0;
+	int err = 0;
+
+	while (records < max_records)
+	{
+		err = telemetry_log_iter_next(iter, &record);
+		if (err)
+		{
+			break;
+		}
+		if (*skip > 0)
+		{
+			(*skip)--;
+			continue;
+		}
+		memcpy(&packet[LOG_TRANSFER_HEADER_LEN + records * RECORD_SIZE], &record, RECORD_SIZE);
+		records++;
+	}
+
+	if (err == -ENODATA)
+	{
+		*end_of_log = true;
+	}
+	else if (err)
+	{
+		return err;
+	}
+	if (records > 0)
+	{
+		sys_put_le32(offset, packet);
+	}
+	return records;
+}
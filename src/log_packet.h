@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) 2025 Grovety Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "telemetry_log.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief Reads the next records of a log transfer into a data
+     *  notification, after its header.
+     *
+     * The records before the requested offset are read and dropped first,
+     * so that a resumed transfer starts with the first record not received.
+     *
+     * @param iter Position of the transfer in the log.
+     * @param skip Records still to drop, decremented as they are read.
+     * @param offset Offset of the first record of the packet, written in
+     *  its header.
+     * @param packet Buffer of LOG_TRANSFER_HEADER_LEN bytes followed by
+     *  max_records records.
+     * @param max_records Records the packet holds at most.
+     * @param end_of_log Set when the last record of the log was read.
+     *
+     * @return Number of records in the packet, or a negative error code.
+     */
+    int log_packet_fill(struct telemetry_log_iter *iter, uint32_t *skip, uint32_t offset,
+                        uint8_t *packet, uint16_t max_records, bool *end_of_log);
+
+#ifdef __cplusplus
+}
+#endif
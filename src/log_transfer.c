@@ -0,0 +1,346 @@
+/*
+ * Copyright (c) 2025 Grovety Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/gatt.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/byteorder.h>
+
+#include "ble.h"
+#include "conn_policy.h"
+#include "log_packet.h"
+#include "log_transfer.h"
+#include "telemetry_log.h"
+
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_DECLARE(app, CONFIG_APP_LOG_LEVEL);
+
+#define RECORD_SIZE sizeof(struct telemetry_record)
+/* Records in the largest notification */
+#define PACKET_RECORDS_MAX ((CONFIG_BT_L2CAP_TX_MTU - 3 - LOG_TRANSFER_HEADER_LEN) / RECORD_SIZE)
+#define PACKET_SIZE_MAX (LOG_TRANSFER_HEADER_LEN + PACKET_RECORDS_MAX * RECORD_SIZE)
+
+/* Retry delay when the stack is out of buffers and nothing is in flight */
+#define RETRY_DELAY K_MSEC(10)
+
+BUILD_ASSERT(PACKET_RECORDS_MAX >= 1, "CONFIG_BT_L2CAP_TX_MTU too small for a log record");
+
+struct transfer
+{
+	struct bt_conn *conn;
+	struct telemetry_log_iter iter;
+	/* Records still to skip to reach the requested offset */
+	uint32_t skip;
+	/* Offset of the next record read */
+	uint32_t offset;
+	uint32_t records;
+	uint32_t bytes;
+	int64_t start_ms;
+	bool end_of_log;
+	bool abort;
+	/* Notification built but not sent yet */
+	uint8_t packet[PACKET_SIZE_MAX];
+	uint16_t packet_len;
+	uint16_t packet_records;
+};
+
+static struct transfer transfer;
+static atomic_t in_flight;
+static K_MUTEX_DEFINE(transfer_mutex);
+
+static void transfer_work_handler(struct k_work *work);
+
+static K_WORK_DELAYABLE_DEFINE(transfer_work, transfer_work_handler);
+
+static ssize_t write_control(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+							 const void *buf, uint16_t len, uint16_t offset, uint8_t flags);
+
+BT_GATT_SERVICE_DEFINE(log_svc,
+					   BT_GATT_PRIMARY_SERVICE(BT_UUID_LOG_SERVICE),
+					   BT_GATT_CHARACTERISTIC(BT_UUID_GATT_LOG_CONTROL,
+											  BT_GATT_CHRC_WRITE | BT_GATT_CHRC_NOTIFY,
+											  BT_GATT_PERM_WRITE_ENCRYPT,
+											  NULL, write_control, NULL),
+					   BT_GATT_CCC(NULL, BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
+					   BT_GATT_CHARACTERISTIC(BT_UUID_GATT_LOG_DATA,
+											  BT_GATT_CHRC_NOTIFY,
+											  BT_GATT_PERM_NONE,
+											  NULL, NULL, NULL),
+					   BT_GATT_CCC(NULL, BT_GATT_PERM_READ | BT_GATT_PERM_WRITE), );
+
+#define CONTROL_ATTR (&log_svc.attrs[2])
+#define DATA_ATTR (&log_svc.attrs[5])
+
+static void send_response(struct bt_conn *conn, uint8_t request, enum log_transfer_status status)
+{
+	const uint8_t response[] = {LOG_TRANSFER_OP_RESPONSE, request, status};
+
+	bt_gatt_notify(conn, CONTROL_ATTR, response, sizeof(response));
+}
+
+/* Called with transfer_mutex held */
+static void transfer_finish(enum log_transfer_status status)
+{
+	int64_t duration_ms = k_uptime_get() - transfer.start_ms;
+	uint32_t throughput = 0;
+	uint8_t report[2 + 4 * sizeof(uint32_t)];
+
+	if (duration_ms > 0)
+	{
+		throughput = (uint32_t)((uint64_t)transfer.bytes * MSEC_PER_SEC / duration_ms);
+	}
+	report[0] = LOG_TRANSFER_OP_REPORT;
+	report[1] = status;
+	sys_put_le32(transfer.records, &report[2]);
+	sys_put_le32(transfer.bytes, &report[6]);
+	sys_put_le32((uint32_t)duration_ms, &report[10]);
+	sys_put_le32(throughput, &report[14]);
+	bt_gatt_notify(transfer.conn, CONTROL_ATTR, report, sizeof(report));
+
+	LOG_INF("Log transfer status %d: %u records, %u bytes in %u ms, %u B/s",
+			status, transfer.records, transfer.bytes, (uint32_t)duration_ms, throughput);
+
+	conn_policy_bulk_end(transfer.conn);
+	bt_conn_unref(transfer.conn);
+	transfer.conn = NULL;
+}
+
+static void notify_complete(struct bt_conn *conn, void *user_data)
+{
+	ARG_UNUSED(conn);
+	ARG_UNUSED(user_data);
+
+	/* A late completion after a new start must not go below zero */
+	atomic_val_t value;
+	do
+	{
+		value = atomic_get(&in_flight);
+		if (value == 0)
+		{
+			break;
+		}
+	} while (!atomic_cas(&in_flight, value, value - 1));
+
+	k_work_reschedule(&transfer_work, K_NO_WAIT);
+}
+
+/* Fills the packet with as many records as the MTU allows */
+static int build_packet(void)
+{
+	uint16_t mtu = bt_gatt_get_mtu(transfer.conn) - 3;
+	uint16_t count = MIN((mtu - LOG_TRANSFER_HEADER_LEN) / RECORD_SIZE, PACKET_RECORDS_MAX);
+	int ret = log_packet_fill(&transfer.iter, &transfer.skip, transfer.offset, transfer.packet,
+							  count, &transfer.end_of_log);
+
+	if (ret < 0)
+	{
+		return ret;
+	}
+	transfer.packet_records = ret;
+	if (ret > 0)
+	{
+		transfer.packet_len = LOG_TRANSFER_HEADER_LEN + ret * RECORD_SIZE;
+	}
+	return 0;
+}
+
+static void transfer_work_handler(struct k_work *work)
+{
+	ARG_UNUSED(work);
+
+	k_mutex_lock(&transfer_mutex, K_FOREVER);
+
+	if (!transfer.conn)
+	{
+		goto unlock;
+	}
+	if (transfer.abort)
+	{
+		transfer_finish(LOG_TRANSFER_ABORTED);
+		goto unlock;
+	}
+
+	while (atomic_get(&in_flight) < CONFIG_APP_LOG_TRANSFER_MAX_IN_FLIGHT)
+	{
+		if (transfer.packet_len == 0)
+		{
+			if (transfer.end_of_log)
+			{
+				break;
+			}
+			if (build_packet())
+			{
+				transfer_finish(LOG_TRANSFER_FAILED);
+				goto unlock;
+			}
+			if (transfer.packet_len == 0)
+			{
+				break;
+			}
+		}
+
+		struct bt_gatt_notify_params params = {
+			.attr = DATA_ATTR,
+			.data = transfer.packet,
+			.len = transfer.packet_len,
+			.func = notify_complete,
+		};
+
+		atomic_inc(&in_flight);
+		int err = bt_gatt_notify_cb(transfer.conn, &params);
+		if (err)
+		{
+			atomic_dec(&in_flight);
+			if (err == -ENOMEM || err == -ENOBUFS)
+			{
+				/* Retried on the next completion, or after a while if
+				 * nothing is in flight to complete.
+				 */
+				if (atomic_get(&in_flight) == 0)
+				{
+					k_work_schedule(&transfer_work, RETRY_DELAY);
+				}
+				goto unlock;
+			}
+			LOG_WRN("Failed to notify log data (err %d)", err);
+			transfer_finish(LOG_TRANSFER_FAILED);
+			goto unlock;
+		}
+
+		transfer.offset += transfer.packet_records;
+		transfer.records += transfer.packet_records;
+		transfer.bytes += transfer.packet_len;
+		transfer.packet_len = 0;
+	}
+
+	if (transfer.end_of_log && transfer.packet_len == 0 && atomic_get(&in_flight) == 0)
+	{
+		transfer_finish(LOG_TRANSFER_SUCCESS);
+	}
+
+unlock:
+	k_mutex_unlock(&transfer_mutex);
+}
+
+static enum log_transfer_status transfer_start(struct bt_conn *conn, uint32_t since, uint32_t offset)
+{
+	if (transfer.conn)
+	{
+		return LOG_TRANSFER_BUSY;
+	}
+	if (!bt_gatt_is_subscribed(conn, DATA_ATTR, BT_GATT_CCC_NOTIFY))
+	{
+		return LOG_TRANSFER_NOT_SUBSCRIBED;
+	}
+	if (bt_gatt_get_mtu(conn) < 3 + LOG_TRANSFER_HEADER_LEN + RECORD_SIZE)
+	{
+		return LOG_TRANSFER_MTU_TOO_SMALL;
+	}
+
+	/* Records still batched in RAM are sent too */
+	int err = telemetry_log_flush();
+	if (!err)
+	{
+		err = telemetry_log_iter_init(&transfer.iter, since);
+	}
+	if (err)
+	{
+		return LOG_TRANSFER_FAILED;
+	}
+
+	transfer.conn = bt_conn_ref(conn);
+	transfer.skip = offset;
+	transfer.offset = offset;
+	transfer.records = 0;
+	transfer.bytes = 0;
+	transfer.start_ms = k_uptime_get();
+	transfer.end_of_log = false;
+	transfer.abort = false;
+	transfer.packet_len = 0;
+	atomic_set(&in_flight, 0);
+
+	conn_policy_bulk_begin(conn);
+	k_work_reschedule(&transfer_work, K_NO_WAIT);
+
+	LOG_INF("Log transfer from %u s, offset %u", since, offset);
+	return LOG_TRANSFER_SUCCESS;
+}
+
+static ssize_t write_control(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+							 const void *buf, uint16_t len, uint16_t offset, uint8_t flags)
+{
+	const uint8_t *data = buf;
+	enum log_transfer_status status;
+
+	ARG_UNUSED(attr);
+	ARG_UNUSED(flags);
+
+	if (offset != 0)
+	{
+		return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
+	}
+	if (len < 1)
+	{
+		return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+	}
+
+	k_mutex_lock(&transfer_mutex, K_FOREVER);
+
+	switch (data[0])
+	{
+	case LOG_TRANSFER_OP_START:
+		if (len != 1 + 2 * sizeof(uint32_t))
+		{
+			status = LOG_TRANSFER_INVALID_PARAMETER;
+			break;
+		}
+		status = transfer_start(conn, sys_get_le32(&data[1]), sys_get_le32(&data[5]));
+		break;
+
+	case LOG_TRANSFER_OP_ABORT:
+		if (transfer.conn != conn)
+		{
+			status = LOG_TRANSFER_INVALID_PARAMETER;
+			break;
+		}
+		/* The report follows from the work handler */
+		transfer.abort = true;
+		k_work_reschedule(&transfer_work, K_NO_WAIT);
+		status = LOG_TRANSFER_SUCCESS;
+		break;
+
+	default:
+		status = LOG_TRANSFER_NOT_SUPPORTED;
+		break;
+	}
+
+	k_mutex_unlock(&transfer_mutex);
+
+	send_response(conn, data[0], status);
+	return len;
+}
+
+static void disconnected(struct bt_conn *conn, uint8_t reason)
+{
+	ARG_UNUSED(reason);
+
+	k_mutex_lock(&transfer_mutex, K_FOREVER);
+	if (transfer.conn == conn)
+	{
+		/* The client resumes from the last offset it received */
+		LOG_INF("Log transfer interrupted at offset %u", transfer.offset);
+		bt_conn_unref(transfer.conn);
+		transfer.conn = NULL;
+	}
+	k_mutex_unlock(&transfer_mutex);
+}
+
+BT_CONN_CB_DEFINE(log_transfer_conn_callbacks) = {
+	.disconnected = disconnected,
+};
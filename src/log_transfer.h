@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2025 Grovety Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+/*
+ * Bulk download of the telemetry log, over the log service.
+ *
+ * The client subscribes to both characteristics and writes a start request
+ * to the control point. The records are notified on the data
+ * characteristic, as many per notification as the ATT MTU allows. Each
+ * notification starts with the little endian offset of its first record,
+ * counted from the first record at or after the requested time. The data
+ * is followed by a report on the control point.
+ *
+ * A transfer cut short by a disconnection resumes by starting again at
+ * the same time, with the offset of the first record not received.
+ */
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** Start request: opcode, log time in seconds (u32), offset (u32) */
+#define LOG_TRANSFER_OP_START 0x01
+/** Abort request: opcode */
+#define LOG_TRANSFER_OP_ABORT 0x02
+
+/** Response to a request: opcode, request opcode, status */
+#define LOG_TRANSFER_OP_RESPONSE 0x80
+/** End of a transfer: opcode, status, records (u32), bytes (u32),
+ *  duration in ms (u32), throughput in bytes per second (u32) */
+#define LOG_TRANSFER_OP_REPORT 0x81
+
+/** Length of the data notification header */
+#define LOG_TRANSFER_HEADER_LEN 4
+
+    /**
+     * @brief Status of a request or a transfer.
+     */
+    enum log_transfer_status
+    {
+        LOG_TRANSFER_SUCCESS = 0x00,
+        LOG_TRANSFER_NOT_SUPPORTED = 0x01,
+        LOG_TRANSFER_INVALID_PARAMETER = 0x02,
+        LOG_TRANSFER_BUSY = 0x03,
+        /** The data characteristic is not subscribed to. */
+        LOG_TRANSFER_NOT_SUBSCRIBED = 0x04,
+        /** The ATT MTU cannot hold a record. */
+        LOG_TRANSFER_MTU_TOO_SMALL = 0x05,
+        LOG_TRANSFER_ABORTED = 0x06,
+        LOG_TRANSFER_FAILED = 0x07,
+    };
+
+#ifdef __cplusplus
+}
+#endif
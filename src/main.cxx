@@ -8,12 +8,270 @@
 #include <zephyr/logging/log.h>
 #include <zephyr/usb/usb_device.h>
 
+#include "adv_policy.h"
 #include "ble.h"
+#include "history.h"
 #include "led.h"
+#include "sampling_policy.h"
 #include "sensor.hxx"
+#include "telemetry_log.h"
 
 LOG_MODULE_REGISTER(app, CONFIG_APP_LOG_LEVEL);
 
+#if CONFIG_APP_ADAPTIVE_SAMPLING
+static const struct sampling_policy_config policy_config = {
+    .low_battery_pptt = CONFIG_APP_SAMPLING_LOW_BATTERY_PPTT,
+    .critical_battery_pptt = CONFIG_APP_SAMPLING_CRITICAL_BATTERY_PPTT,
+    .battery_hysteresis_pptt = CONFIG_APP_SAMPLING_BATTERY_HYSTERESIS_PPTT,
+    .co2_rise_per_min = CONFIG_APP_SAMPLING_CO2_RISE_PPM_PER_MIN,
+    .iaq_rise_per_min = CONFIG_APP_SAMPLING_IAQ_RISE_PER_MIN,
+    .fast_hold_ms = CONFIG_APP_SAMPLING_FAST_HOLD_SEC * MSEC_PER_SEC,
+};
+
+struct sampling_mode
+{
+    enum bme68x_iaq_sample_rate sample_rate;
+    uint16_t adv_interval_min;
+    uint16_t adv_interval_max;
+};
+
+/* Indexed by enum sampling_level */
+static const struct sampling_mode sampling_modes[] = {
+    /* SAMPLING_LEVEL_FAST */
+    {BME68X_IAQ_SAMPLE_RATE_LOW_POWER, BT_GAP_ADV_FAST_INT_MIN_2, BT_GAP_ADV_FAST_INT_MAX_2},
+    /* SAMPLING_LEVEL_NORMAL */
+    {BME68X_IAQ_SAMPLE_RATE_QUICK_ULTRA_LOW_POWER, BT_GAP_ADV_SLOW_INT_MIN, BT_GAP_ADV_SLOW_INT_MAX},
+    /* SAMPLING_LEVEL_SAVING, 2 s to 2.5 s */
+    {BME68X_IAQ_SAMPLE_RATE_QUICK_ULTRA_LOW_POWER, 0x0c80, 0x0fa0},
+    /* SAMPLING_LEVEL_CRITICAL, 5 s to 6 s */
+    {BME68X_IAQ_SAMPLE_RATE_ULTRA_LOW_POWER, 0x1f40, 0x2580},
+};
+BUILD_ASSERT(ARRAY_SIZE(sampling_modes) == SAMPLING_LEVEL_CRITICAL + 1);
+
+static struct sampling_policy policy;
+static enum sampling_level sampling_level = SAMPLING_LEVEL_NORMAL;
+static enum bme68x_iaq_sample_rate sampling_rate;
+/* The mode of the first level is applied even if it is the default one */
+static bool sampling_applied;
+
+/* Sample modes from the least to the most power hungry */
+static int sample_rate_power(enum bme68x_iaq_sample_rate rate)
+{
+    switch (rate)
+    {
+    case BME68X_IAQ_SAMPLE_RATE_ULTRA_LOW_POWER:
+        return 0;
+    case BME68X_IAQ_SAMPLE_RATE_QUICK_ULTRA_LOW_POWER:
+        return 1;
+    case BME68X_IAQ_SAMPLE_RATE_LOW_POWER:
+        return 2;
+    default:
+        return 3;
+    }
+}
+
+/* The stored mode is the mode of SAMPLING_LEVEL_NORMAL. The fast level never
+ * samples slower than it, the battery levels never faster.
+ */
+static enum bme68x_iaq_sample_rate level_sample_rate(enum sampling_level level,
+                                                     enum bme68x_iaq_sample_rate stored)
+{
+    enum bme68x_iaq_sample_rate rate = sampling_modes[level].sample_rate;
+
+    switch (level)
+    {
+    case SAMPLING_LEVEL_FAST:
+        return sample_rate_power(stored) > sample_rate_power(rate) ? stored : rate;
+    case SAMPLING_LEVEL_NORMAL:
+        return stored;
+    default:
+        return sample_rate_power(stored) < sample_rate_power(rate) ? stored : rate;
+    }
+}
+
+static void update_sampling(CSensor &sensor)
+{
+    int battery_pptt = sensor.get_battery_pptt();
+    const struct sampling_input input = {
+        .timestamp_ms = k_uptime_get(),
+        .battery_pptt = battery_pptt < 0 ? 0U : static_cast<unsigned int>(battery_pptt),
+        .has_battery = battery_pptt >= 0,
+        .co2 = sensor.get_co2(),
+        .iaq = static_cast<float>(sensor.get_iaq()),
+    };
+
+    enum sampling_level level = sampling_policy_update(&policy, &input);
+    /* Read each time, the "bsec rate" shell command changes it */
+    enum bme68x_iaq_sample_rate stored = sampling_modes[SAMPLING_LEVEL_NORMAL].sample_rate;
+    (void)sensor.get_stored_sample_rate(&stored);
+    enum bme68x_iaq_sample_rate rate = level_sample_rate(level, stored);
+
+    if (sampling_applied && level == sampling_level && rate == sampling_rate)
+    {
+        return;
+    }
+
+    LOG_INF("Sampling level %d -> %d, sample mode %d", sampling_level, level, rate);
+    if (level == SAMPLING_LEVEL_CRITICAL && sampling_level != SAMPLING_LEVEL_CRITICAL)
+    {
+        /* Keep the calibration and logged samples in case the battery runs out */
+        sensor.save_state();
+#if CONFIG_APP_TELEMETRY_LOG
+        telemetry_log_flush();
+#endif
+    }
+    /* The advertising interval is applied by update_advertising() */
+    if (sensor.set_sample_rate(rate) == 0)
+    {
+        sampling_level = level;
+        sampling_rate = rate;
+        sampling_applied = true;
+    }
+}
+#endif /* CONFIG_APP_ADAPTIVE_SAMPLING */
+
+#if CONFIG_APP_ADAPTIVE_ADV
+static const struct adv_policy_config adv_config = {
+    .co2_alarm_ppm = CONFIG_APP_ADV_CO2_ALARM_PPM,
+    .co2_delta_ppm = CONFIG_APP_ADV_CO2_DELTA_PPM,
+    .iaq_delta = CONFIG_APP_ADV_IAQ_DELTA,
+    .temperature_delta = CONFIG_APP_ADV_TEMPERATURE_DELTA_CENTI / 100.0f,
+    .humidity_delta = CONFIG_APP_ADV_HUMIDITY_DELTA_CENTI / 100.0f,
+    .burst_ms = CONFIG_APP_ADV_BURST_SEC * MSEC_PER_SEC,
+    .stable_ms = CONFIG_APP_ADV_STABLE_SEC * MSEC_PER_SEC,
+};
+
+/* Interval used while readings are stable, 8 s to 10 s */
+#define ADV_STABLE_INT_MIN 0x3200
+#define ADV_STABLE_INT_MAX 0x3e80
+
+static struct adv_policy adv_policy;
+#endif /* CONFIG_APP_ADAPTIVE_ADV */
+
+#if CONFIG_APP_HISTORY
+static void update_history(CSensor &sensor)
+{
+    struct history_sample sample = {};
+
+    sample.timestamp_ms = sensor.get_timestamp_ms();
+    sample.values[HISTORY_TEMPERATURE] = sensor.get_temperature();
+    sample.values[HISTORY_HUMIDITY] = sensor.get_humidity();
+    sample.values[HISTORY_PRESSURE] = sensor.get_pressure();
+    sample.values[HISTORY_CO2] = sensor.get_co2();
+    sample.values[HISTORY_VOC] = sensor.get_voc();
+    sample.values[HISTORY_IAQ] = static_cast<float>(sensor.get_iaq());
+    history_append(&sample);
+}
+#endif /* CONFIG_APP_HISTORY */
+
+#if CONFIG_APP_TELEMETRY_LOG
+static void update_telemetry_log(CSensor &sensor)
+{
+    static uint32_t last_logged;
+    static bool logged;
+    uint32_t now = telemetry_log_time();
+
+    if (logged && now - last_logged < CONFIG_APP_TELEMETRY_LOG_INTERVAL_SEC)
+    {
+        return;
+    }
+
+    struct telemetry_record record = {};
+    float battery_percent;
+
+    record.temperature = static_cast<int16_t>(sensor.get_temperature() * 100.0f);
+    record.humidity = static_cast<uint16_t>(sensor.get_humidity() * 100.0f);
+    record.pressure = static_cast<uint32_t>(sensor.get_pressure());
+    record.co2 = static_cast<uint16_t>(sensor.get_co2());
+    record.voc = static_cast<uint16_t>(sensor.get_voc());
+    record.iaq = sensor.get_iaq();
+    record.battery = TELEMETRY_LOG_BATTERY_UNKNOWN;
+    if (sensor.get_battery_percent(&battery_percent) == 0)
+    {
+        record.battery = static_cast<uint8_t>(battery_percent);
+    }
+    /* Same layout as the status of the sensor record */
+    record.status = (sensor.get_iaq_accuracy() & 0x03) | ((sensor.get_co2_accuracy() & 0x03) << 2) |
+                    ((sensor.get_voc_accuracy() & 0x03) << 4) |
+                    (sensor.is_run_in_complete() ? BIT(6) : 0) | (sensor.is_stabilized() ? BIT(7) : 0);
+
+    if (telemetry_log_append(&record) == 0)
+    {
+        last_logged = now;
+        logged = true;
+    }
+}
+#endif /* CONFIG_APP_TELEMETRY_LOG */
+
+static void publish_measurements(CSensor &sensor)
+{
+    float battery_percent;
+
+    bt_set_temperature(sensor.get_temperature());
+    bt_set_humidity(sensor.get_humidity());
+    bt_set_pressure(sensor.get_pressure());
+    bt_set_co2(sensor.get_co2());
+    bt_set_voc(sensor.get_voc());
+    bt_set_iaq(sensor.get_iaq());
+    /* The battery level is not updated until the battery was sampled */
+    if (sensor.get_battery_percent(&battery_percent) == 0)
+    {
+        bt_set_battery(static_cast<uint8_t>(battery_percent));
+    }
+    bt_set_sensor_status(sensor.get_iaq_accuracy(), sensor.get_co2_accuracy(),
+                         sensor.get_voc_accuracy(), sensor.is_run_in_complete(),
+                         sensor.is_stabilized());
+    bt_publish_record(sensor.get_timestamp_ms());
+}
+
+static void update_advertising(CSensor &sensor)
+{
+    uint16_t interval_min = BT_GAP_ADV_SLOW_INT_MIN;
+    uint16_t interval_max = BT_GAP_ADV_SLOW_INT_MAX;
+    bool battery_critical = false;
+
+#if CONFIG_APP_ADAPTIVE_SAMPLING
+    interval_min = sampling_modes[sampling_level].adv_interval_min;
+    interval_max = sampling_modes[sampling_level].adv_interval_max;
+    battery_critical = sampling_level == SAMPLING_LEVEL_CRITICAL;
+#endif
+
+#if CONFIG_APP_ADAPTIVE_ADV
+    const struct adv_input input = {
+        .timestamp_ms = k_uptime_get(),
+        .temperature = sensor.get_temperature(),
+        .humidity = sensor.get_humidity(),
+        .co2 = sensor.get_co2(),
+        .iaq = static_cast<float>(sensor.get_iaq()),
+    };
+
+    switch (adv_policy_update(&adv_policy, &input))
+    {
+    case ADV_MODE_BURST:
+        /* Alerts still get through fast, but not on an empty battery */
+        if (!battery_critical)
+        {
+            interval_min = BT_GAP_ADV_FAST_INT_MIN_2;
+            interval_max = BT_GAP_ADV_FAST_INT_MAX_2;
+        }
+        break;
+
+    case ADV_MODE_STABLE:
+        interval_min = MAX(interval_min, ADV_STABLE_INT_MIN);
+        interval_max = MAX(interval_max, ADV_STABLE_INT_MAX);
+        break;
+
+    default:
+        break;
+    }
+#else
+    ARG_UNUSED(sensor);
+    ARG_UNUSED(battery_critical);
+#endif
+
+    bt_set_adv_interval(interval_min, interval_max);
+}
+
 int main(void)
 {
     int err = 0;
@@ -56,8 +314,34 @@ int main(void)
         return err;
     }
 
+    /* Advertise the outputs saved before the last reset until BSEC has
+     * new ones. They are not logged, since they were measured back then.
+     */
+    if (sensor.update_measurements() == 0)
+    {
+        publish_measurements(sensor);
+        update_advertise_data();
+    }
+
+#if CONFIG_APP_TELEMETRY_LOG
+    /* Sampling goes on without the log, the error is logged */
+    (void)telemetry_log_init();
+#endif
+#if CONFIG_APP_ADAPTIVE_SAMPLING
+    sampling_policy_init(&policy, &policy_config);
+#endif
+#if CONFIG_APP_ADAPTIVE_ADV
+    adv_policy_init(&adv_policy, &adv_config);
+#endif
+
     while (true)
     {
+        /* Sleep until the BSEC work publishes a new output */
+        err = sensor.wait_for_data(K_FOREVER);
+        if (err)
+        {
+            continue;
+        }
         blink_led(&led, 100);
         err = sensor.update_measurements();
         if (err)
@@ -65,15 +349,18 @@ int main(void)
             LOG_ERR("Failed to update measurements (err %d)", err);
             continue;
         }
-        bt_set_temperature(sensor.get_temperature());
-        bt_set_humidity(sensor.get_humidity());
-        bt_set_pressure(sensor.get_pressure());
-        bt_set_co2(sensor.get_co2());
-        bt_set_voc(sensor.get_voc());
-        bt_set_iaq(sensor.get_iaq());
-        bt_set_battery(sensor.get_battery_percent());
+        publish_measurements(sensor);
+#if CONFIG_APP_HISTORY
+        update_history(sensor);
+#endif
+#if CONFIG_APP_TELEMETRY_LOG
+        update_telemetry_log(sensor);
+#endif
         update_advertise_data();
-        k_sleep(K_MSEC(3000)); // 3 s
+#if CONFIG_APP_ADAPTIVE_SAMPLING
+        update_sampling(sensor);
+#endif
+        update_advertising(sensor);
     }
 
     return 0;
@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2025 Grovety Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+
+#include "sampling_policy.h"
+
+void sampling_policy_init(struct sampling_policy *policy,
+						  const struct sampling_policy_config *config)
+{
+	memset(policy, 0, sizeof(*policy));
+	policy->config = config;
+	policy->battery_level = SAMPLING_LEVEL_NORMAL;
+}
+
+static enum sampling_level battery_level_update(enum sampling_level level,
+												const struct sampling_policy_config *cfg,
+												unsigned int pptt)
+{
+	switch (level)
+	{
+	case SAMPLING_LEVEL_CRITICAL:
+		if (pptt >= (unsigned int)cfg->critical_battery_pptt + cfg->battery_hysteresis_pptt)
+		{
+			level = SAMPLING_LEVEL_SAVING;
+		}
+		break;
+
+	case SAMPLING_LEVEL_SAVING:
+		if (pptt < cfg->critical_battery_pptt)
+		{
+			level = SAMPLING_LEVEL_CRITICAL;
+		}
+		else if (pptt >= (unsigned int)cfg->low_battery_pptt + cfg->battery_hysteresis_pptt)
+		{
+			level = SAMPLING_LEVEL_NORMAL;
+		}
+		break;
+
+	default:
+		if (pptt < cfg->critical_battery_pptt)
+		{
+			level = SAMPLING_LEVEL_CRITICAL;
+		}
+		else if (pptt < cfg->low_battery_pptt)
+		{
+			level = SAMPLING_LEVEL_SAVING;
+		}
+		else
+		{
+			level = SAMPLING_LEVEL_NORMAL;
+		}
+		break;
+	}
+	return level;
+}
+
+static bool rising_fast(const struct sampling_policy *policy, const struct sampling_input *input)
+{
+	const struct sampling_policy_config *cfg = policy->config;
+	int64_t elapsed_ms = input->timestamp_ms - policy->last_ms;
+
+	if (!policy->has_last || elapsed_ms <= 0)
+	{
+		return false;
+	}
+
+	float minutes = (float)elapsed_ms / 60000.0f;
+
+	return ((input->co2 - policy->last_co2) / minutes >= cfg->co2_rise_per_min) ||
+		   ((input->iaq - policy->last_iaq) / minutes >= cfg->iaq_rise_per_min);
+}
+
+enum sampling_level sampling_policy_update(struct sampling_policy *policy,
+										   const struct sampling_input *input)
+{
+	const struct sampling_policy_config *cfg = policy->config;
+
+	if (input->has_battery)
+	{
+		policy->battery_level = battery_level_update(policy->battery_level, cfg,
+													 input->battery_pptt);
+	}
+
+	/* Gas outputs may be refreshed much less often than the policy is
+	 * called, so rates are computed between readings that differ.
+	 */
+	if (!policy->has_last || input->co2 != policy->last_co2 || input->iaq != policy->last_iaq)
+	{
+		if (rising_fast(policy, input))
+		{
+			policy->fast_until_ms = input->timestamp_ms + cfg->fast_hold_ms;
+		}
+		policy->last_co2 = input->co2;
+		policy->last_iaq = input->iaq;
+		policy->last_ms = input->timestamp_ms;
+		policy->has_last = true;
+	}
+
+	if (policy->battery_level != SAMPLING_LEVEL_CRITICAL &&
+		input->timestamp_ms < policy->fast_until_ms)
+	{
+		return SAMPLING_LEVEL_FAST;
+	}
+	return policy->battery_level;
+}
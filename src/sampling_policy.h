@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2025 Grovety Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief Sampling levels selected by the policy, from the most to the least
+     *  power hungry.
+     */
+    enum sampling_level
+    {
+        /** Readings change fast, sample and advertise often. */
+        SAMPLING_LEVEL_FAST,
+        /** Regular operation. */
+        SAMPLING_LEVEL_NORMAL,
+        /** Battery is low, sample and advertise less often. */
+        SAMPLING_LEVEL_SAVING,
+        /** Battery is almost empty, use the slowest rates. */
+        SAMPLING_LEVEL_CRITICAL,
+    };
+
+    /**
+     * @brief Thresholds of the sampling policy.
+     */
+    struct sampling_policy_config
+    {
+        /** Battery level below which SAMPLING_LEVEL_SAVING is used, in pptt. */
+        uint16_t low_battery_pptt;
+        /** Battery level below which SAMPLING_LEVEL_CRITICAL is used, in pptt. */
+        uint16_t critical_battery_pptt;
+        /** Margin above a battery threshold needed to leave its level, in pptt. */
+        uint16_t battery_hysteresis_pptt;
+        /** CO2 rise that switches to SAMPLING_LEVEL_FAST, in ppm per minute. */
+        float co2_rise_per_min;
+        /** IAQ rise that switches to SAMPLING_LEVEL_FAST, per minute. */
+        float iaq_rise_per_min;
+        /** Time SAMPLING_LEVEL_FAST is kept after the last fast rise, in milliseconds. */
+        uint32_t fast_hold_ms;
+    };
+
+    /**
+     * @brief Inputs of one policy step.
+     */
+    struct sampling_input
+    {
+        /** Time of the readings, in milliseconds. */
+        int64_t timestamp_ms;
+        /** Remaining battery capacity, in parts per ten thousand. */
+        unsigned int battery_pptt;
+        /** False until the battery was sampled, battery_pptt is then
+         *  ignored and the battery level kept. */
+        bool has_battery;
+        /** CO2 concentration, in ppm. */
+        float co2;
+        /** Index for air quality. */
+        float iaq;
+    };
+
+    /**
+     * @brief State of the sampling policy. Fields are private.
+     */
+    struct sampling_policy
+    {
+        const struct sampling_policy_config *config;
+        enum sampling_level battery_level;
+        int64_t fast_until_ms;
+        int64_t last_ms;
+        float last_co2;
+        float last_iaq;
+        bool has_last;
+    };
+
+    /**
+     * @brief Initializes the policy in SAMPLING_LEVEL_NORMAL.
+     *
+     * @param policy Policy to initialize.
+     * @param config Thresholds, must stay valid while the policy is used.
+     */
+    void sampling_policy_init(struct sampling_policy *policy,
+                              const struct sampling_policy_config *config);
+
+    /**
+     * @brief Feeds new readings to the policy.
+     *
+     * The battery level steps down when a threshold is crossed and only steps
+     * back up once the battery is above the threshold plus the hysteresis.
+     * A fast CO2 or IAQ rise selects SAMPLING_LEVEL_FAST for at least
+     * fast_hold_ms, unless the battery is critical.
+     *
+     * @param policy Policy to update.
+     * @param input Latest readings.
+     *
+     * @return Sampling level to use.
+     */
+    enum sampling_level sampling_policy_update(struct sampling_policy *policy,
+                                               const struct sampling_input *input);
+
+#ifdef __cplusplus
+}
+#endif
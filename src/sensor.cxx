@@ -4,7 +4,7 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
-#include <drivers/bme68x_iaq.h>
+#include <math.h>
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
 
@@ -13,7 +13,23 @@ LOG_MODULE_DECLARE(app, CONFIG_APP_LOG_LEVEL);
 #include "battery.h"
 #include "sensor.hxx"
 
-CSensor::CSensor()
+/* Given by the driver each time BSEC produces a new output */
+static K_SEM_DEFINE(data_ready_sem, 0, 1);
+
+static const struct sensor_trigger data_ready_trigger = {
+    .type = SENSOR_TRIG_DATA_READY,
+    .chan = SENSOR_CHAN_ALL,
+};
+
+static void data_ready_handler(const struct device *dev, const struct sensor_trigger *trigger)
+{
+    ARG_UNUSED(dev);
+    ARG_UNUSED(trigger);
+
+    k_sem_give(&data_ready_sem);
+}
+
+CSensor::CSensor() : bme_sensor(nullptr), sample{}
 {
 }
 
@@ -36,16 +52,28 @@ int CSensor::init()
         return -1;
     }
 
-    int err = battery_measure_enable(true);
+    int err = sensor_trigger_set(bme_sensor, &data_ready_trigger, data_ready_handler);
+    if (err)
+    {
+        LOG_ERR("Failed to set data ready trigger: %d", err);
+        return err;
+    }
+
+    err = battery_service_start();
     if (err)
     {
-        LOG_ERR("Failed to initialize battery measurement: %d", err);
+        LOG_ERR("Failed to start battery service: %d", err);
         return err;
     }
 
     return 0;
 }
 
+int CSensor::wait_for_data(k_timeout_t timeout)
+{
+    return k_sem_take(&data_ready_sem, timeout);
+}
+
 int CSensor::update_measurements()
 {
     if (!bme_sensor)
@@ -54,62 +82,75 @@ int CSensor::update_measurements()
         return -1;
     }
 
-    int err = 0;
-
-    err = sensor_sample_fetch(bme_sensor);
-    if (err)
-    {
-        LOG_ERR("Failed to fetch sensor sample: %d", err);
-        return err;
-    }
-    err = sensor_channel_get(bme_sensor, SENSOR_CHAN_AMBIENT_TEMP, &temp);
-    if (err)
+    int err = bme68x_iaq_get_snapshot(bme_sensor, &sample);
+    if (err == -ENODATA)
     {
-        LOG_ERR("Failed to fetch temperature sensor data: %d", err);
+        /* Nothing published yet, the first BSEC output is still pending */
         return err;
     }
-    err = sensor_channel_get(bme_sensor, SENSOR_CHAN_PRESS, &press);
     if (err)
     {
-        LOG_ERR("Failed to fetch pressure sensor data: %d", err);
+        LOG_ERR("Failed to get sensor snapshot: %d", err);
         return err;
     }
-    err = sensor_channel_get(bme_sensor, SENSOR_CHAN_HUMIDITY, &humidity);
-    if (err)
-    {
-        LOG_ERR("Failed to fetch humidity sensor data: %d", err);
-        return err;
-    }
-    err = sensor_channel_get(bme_sensor, static_cast<sensor_channel>(SENSOR_CHAN_IAQ), &iaq);
+
+    /* nan until the battery was sampled */
+    float battery_percent = NAN;
+
+    (void)get_battery_percent(&battery_percent);
+    LOG_INF("temp: %.2f; press: %.2f; humidity: %.2f; iaq: %u; CO2: %.2f; VOC: %.2f; "
+            "battery_percent: %.2f",
+            (double)sample.temperature, (double)sample.pressure, (double)sample.humidity,
+            sample.air_quality, (double)sample.co2, (double)sample.voc,
+            (double)battery_percent);
+
+    return err;
+}
+
+int CSensor::set_sample_rate(enum bme68x_iaq_sample_rate rate)
+{
+    struct sensor_value value = {
+        .val1 = rate,
+        .val2 = 0,
+    };
+
+    int err = sensor_attr_set(bme_sensor, SENSOR_CHAN_ALL,
+                              static_cast<sensor_attribute>(SENSOR_ATTR_BME68X_IAQ_SAMPLE_RATE_RUNTIME),
+                              &value);
     if (err)
     {
-        LOG_ERR("Failed to fetch IAQ sensor data: %d", err);
-        return err;
+        LOG_ERR("Failed to set sample rate: %d", err);
     }
-    err = sensor_channel_get(bme_sensor, SENSOR_CHAN_CO2, &co2);
+    return err;
+}
+
+int CSensor::get_stored_sample_rate(enum bme68x_iaq_sample_rate *rate) const
+{
+    struct sensor_value value;
+
+    int err = sensor_attr_get(bme_sensor, SENSOR_CHAN_ALL,
+                              static_cast<sensor_attribute>(SENSOR_ATTR_BME68X_IAQ_SAMPLE_RATE), &value);
     if (err)
     {
-        LOG_ERR("Failed to fetch CO2 sensor data: %d", err);
         return err;
     }
-    err = sensor_channel_get(bme_sensor, SENSOR_CHAN_VOC, &voc);
+    *rate = static_cast<enum bme68x_iaq_sample_rate>(value.val1);
+    return 0;
+}
+
+int CSensor::save_state()
+{
+    int err = bme68x_iaq_save_state(bme_sensor);
     if (err)
     {
-        LOG_ERR("Failed to fetch VOC sensor data: %d", err);
-        return err;
+        LOG_ERR("Failed to save BSEC state: %d", err);
     }
-
-    LOG_INF("temp: %d.%06d; press: %d.%06d; humidity: %d.%06d; iaq: %d; CO2: %d.%06d; "
-            "VOC: %d.%06d; battery_percent: %.2f",
-            temp.val1, temp.val2, press.val1, press.val2, humidity.val1, humidity.val2,
-            iaq.val1, co2.val1, co2.val2, voc.val1, voc.val2, get_battery_percent());
-
     return err;
 }
 
 float CSensor::get_temperature() const
 {
-    float value = sensor_value_to_float(&temp);
+    float value = sample.temperature;
     if (value > 85.0f)
     {
         value = 85.0f;
@@ -123,7 +164,7 @@ float CSensor::get_temperature() const
 
 float CSensor::get_humidity() const
 {
-    float value = sensor_value_to_float(&humidity);
+    float value = sample.humidity;
     if (value > 100.0f)
     {
         value = 100.0f;
@@ -137,7 +178,7 @@ float CSensor::get_humidity() const
 
 float CSensor::get_pressure() const
 {
-    float value = sensor_value_to_float(&press);
+    float value = sample.pressure;
     if (value > 110000.0f)
     {
         value = 110000.0f;
@@ -151,41 +192,67 @@ float CSensor::get_pressure() const
 
 float CSensor::get_co2() const
 {
-    return sensor_value_to_float(&co2);
+    return sample.co2;
 }
 
 float CSensor::get_voc() const
 {
-    return sensor_value_to_float(&voc);
+    return sample.voc;
 }
 
 uint16_t CSensor::get_iaq() const
 {
-    float value = sensor_value_to_float(&iaq);
-    if (value > 500.0f)
+    uint16_t value = sample.air_quality;
+    if (value > 500)
     {
-        value = 500.0f;
+        value = 500;
     }
-    else if (value < 0.0f)
-    {
-        value = 0.0f;
-    }
-    return static_cast<uint16_t>(value);
+    return value;
 }
 
-float CSensor::get_battery_percent() const
+uint8_t CSensor::get_iaq_accuracy() const
 {
-    int battery = battery_sample();
+    return static_cast<uint8_t>(sample.iaq_accuracy);
+}
 
-    float max = 3000;
-    float min = 2000;
+uint8_t CSensor::get_co2_accuracy() const
+{
+    return static_cast<uint8_t>(sample.co2_accuracy);
+}
 
-    float batteryLevel = static_cast<float>(battery - min) / static_cast<float>(max - min) * 100.0F;
-    if (batteryLevel > 100)
-        batteryLevel = 100;
+uint8_t CSensor::get_voc_accuracy() const
+{
+    return static_cast<uint8_t>(sample.voc_accuracy);
+}
 
-    if (batteryLevel < 0)
-        batteryLevel = 0;
+bool CSensor::is_run_in_complete() const
+{
+    return sample.gas_run_in_status;
+}
+
+bool CSensor::is_stabilized() const
+{
+    return sample.gas_stabilizasion_status;
+}
+
+int64_t CSensor::get_timestamp_ms() const
+{
+    return sample.timestamp_ms;
+}
 
-    return batteryLevel;
+int CSensor::get_battery_percent(float *percent) const
+{
+    int pptt = battery_get_pptt();
+
+    if (pptt < 0)
+    {
+        return pptt;
+    }
+    *percent = static_cast<float>(pptt) / 100.0f;
+    return 0;
+}
+
+int CSensor::get_battery_pptt() const
+{
+    return battery_get_pptt();
 }
@@ -6,7 +6,9 @@
 
 #pragma once
 #include <zephyr/device.h>
+#include <zephyr/kernel.h>
 #include <zephyr/drivers/sensor.h>
+#include <drivers/bme68x_iaq_ext.h>
 
 class CSensor
 {
@@ -21,6 +23,18 @@ public:
     */
    int init();
 
+   /**
+    * @brief Blocks until the sensor driver publishes a new BSEC output.
+    *
+    * The driver signals new data through the SENSOR_TRIG_DATA_READY trigger,
+    * so the caller only wakes up when there is something to publish.
+    *
+    * @param timeout Maximum time to wait for new data.
+    *
+    * @return 0 if new data is available, -EAGAIN if the wait timed out.
+    */
+   int wait_for_data(k_timeout_t timeout);
+
    /**
     * @brief Updates and stores internally the data measured by the sensor
     *  (temperature, pressure, humidity, CO2, VOC, IAQ).
@@ -29,6 +43,35 @@ public:
     */
    int update_measurements();
 
+   /**
+    * @brief Selects the BSEC sample mode of the sensor until the next
+    *  reset. The mode is not stored.
+    *
+    * @param rate Sample mode to use.
+    *
+    * @return 0 if success, error code if failure.
+    */
+   int set_sample_rate(enum bme68x_iaq_sample_rate rate);
+
+   /**
+    * @brief Provides the BSEC sample mode stored in the settings, selected
+    *  with the "bsec rate" shell command. set_sample_rate() does not change
+    *  it.
+    *
+    * @param rate Stored sample mode.
+    *
+    * @return 0 if success, error code if failure.
+    */
+   int get_stored_sample_rate(enum bme68x_iaq_sample_rate *rate) const;
+
+   /**
+    * @brief Saves the BSEC calibration state to flash now, instead of
+    *  waiting for the next periodic save.
+    *
+    * @return 0 if success, error code if failure.
+    */
+   int save_state();
+
    /**
     * @brief Provides the last measured value of temperature.
     *
@@ -83,14 +126,80 @@ public:
     */
    uint16_t get_iaq() const;
 
+   /**
+    * @brief Provides the accuracy of the last IAQ value.
+    *
+    * @note Call update_measurements() to update the value.
+    *
+    * @return Accuracy, 0 (unreliable) to 3 (high).
+    */
+   uint8_t get_iaq_accuracy() const;
+
+   /**
+    * @brief Provides the accuracy of the last CO2 value.
+    *
+    * @note Call update_measurements() to update the value.
+    *
+    * @return Accuracy, 0 (unreliable) to 3 (high).
+    */
+   uint8_t get_co2_accuracy() const;
+
+   /**
+    * @brief Provides the accuracy of the last VOC value.
+    *
+    * @note Call update_measurements() to update the value.
+    *
+    * @return Accuracy, 0 (unreliable) to 3 (high).
+    */
+   uint8_t get_voc_accuracy() const;
+
+   /**
+    * @brief Checks if the gas sensor run-in is complete.
+    *
+    * @note Call update_measurements() to update the value.
+    */
+   bool is_run_in_complete() const;
+
+   /**
+    * @brief Checks if the gas sensor is stabilized.
+    *
+    * @note Call update_measurements() to update the value.
+    */
+   bool is_stabilized() const;
+
+   /**
+    * @brief Provides the time the last values were measured at.
+    *
+    * @note Call update_measurements() to update the value.
+    *
+    * @return System uptime in milliseconds.
+    */
+   int64_t get_timestamp_ms() const;
+
    /**
     * @brief Provides the battery percent.
     *
-    * @return Battery percent.
+    * @note The value is cached by the battery service, calling this does not
+    *  start an ADC conversion.
+    *
+    * @param percent Battery percent.
+    *
+    * @return 0 if success, -ENODATA until the battery was sampled.
+    */
+   int get_battery_percent(float *percent) const;
+
+   /**
+    * @brief Provides the battery level.
+    *
+    * @note The value is cached by the battery service, calling this does not
+    *  start an ADC conversion.
+    *
+    * @return Battery level in parts per ten thousand, or a negative error
+    *  code until the battery was sampled.
     */
-   float get_battery_percent() const;
+   int get_battery_pptt() const;
 
 private:
    const struct device *bme_sensor;
-   struct sensor_value temp, press, humidity, iaq, co2, voc;
+   struct bme_sample_result sample;
 };
@@ -0,0 +1,521 @@
+/*
+ * Copyright (c) 2025 Grovety Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/drivers/flash.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/storage/flash_map.h>
+#include <zephyr/sys/crc.h>
+
+#include "telemetry_log.h"
+
+LOG_MODULE_DECLARE(app, CONFIG_APP_LOG_LEVEL);
+
+#define LOG_PARTITION_ID FIXED_PARTITION_ID(telemetry_partition)
+#define LOG_PARTITION_SIZE FIXED_PARTITION_SIZE(telemetry_partition)
+
+#define SECTOR_SIZE CONFIG_APP_TELEMETRY_LOG_SECTOR_SIZE
+#define SECTOR_COUNT (LOG_PARTITION_SIZE / SECTOR_SIZE)
+#define RECORD_SIZE sizeof(struct telemetry_record)
+/* The first slot of a sector holds its header */
+#define SECTOR_SLOTS (SECTOR_SIZE / RECORD_SIZE - 1)
+#define BATCH_SIZE CONFIG_APP_TELEMETRY_LOG_BATCH
+
+#define SECTOR_MAGIC 0x544c4f47 /* "TLOG" */
+#define SECTOR_VERSION 1
+
+/* Sequence number of a sector holding no valid header */
+#define SECTOR_INVALID 0
+/* First timestamp of a sector holding no valid record */
+#define NO_TIMESTAMP UINT32_MAX
+
+struct sector_header
+{
+	uint32_t magic;
+	uint32_t seq;
+	uint8_t version;
+	uint8_t record_size;
+	uint8_t reserved[18];
+	uint32_t crc;
+} __packed;
+
+BUILD_ASSERT(sizeof(struct telemetry_record) == 32, "Telemetry record must take 32 bytes");
+BUILD_ASSERT(sizeof(struct sector_header) == RECORD_SIZE, "Sector header must fill a slot");
+BUILD_ASSERT(LOG_PARTITION_SIZE % SECTOR_SIZE == 0, "Telemetry partition not a whole number of sectors");
+BUILD_ASSERT(SECTOR_COUNT >= 2, "Telemetry log needs at least two sectors");
+BUILD_ASSERT(BATCH_SIZE <= SECTOR_SLOTS, "Telemetry batch larger than a sector");
+
+/* Sparse index, one entry per sector, so a seek reads a single sector */
+struct sector_info
+{
+	uint32_t seq;
+	uint32_t first_ts;
+};
+
+static const struct flash_area *fa;
+static struct sector_info sectors[SECTOR_COUNT];
+static uint16_t head_sector;
+static uint16_t head_slot;
+static uint32_t next_seq;
+/* Log time at boot */
+static uint32_t time_base;
+
+static struct telemetry_record batch[BATCH_SIZE];
+static uint16_t batch_count;
+
+static K_MUTEX_DEFINE(log_mutex);
+
+static off_t slot_offset(uint16_t sector, uint16_t slot)
+{
+	return (off_t)sector * SECTOR_SIZE + (slot + 1) * RECORD_SIZE;
+}
+
+static uint32_t record_crc(const struct telemetry_record *record)
+{
+	return crc32_ieee((const uint8_t *)record, offsetof(struct telemetry_record, crc));
+}
+
+static bool is_erased(const void *data, size_t len)
+{
+	const uint8_t *bytes = data;
+
+	for (size_t i = 0; i < len; i++)
+	{
+		if (bytes[i] != 0xff)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+/* Returns 0 for a valid record, -ENOENT for an erased slot and -EBADMSG
+ * for a torn or corrupted one.
+ */
+static int read_record(uint16_t sector, uint16_t slot, struct telemetry_record *record)
+{
+	int err = flash_area_read(fa, slot_offset(sector, slot), record, RECORD_SIZE);
+	if (err)
+	{
+		return err;
+	}
+	if (is_erased(record, RECORD_SIZE))
+	{
+		return -ENOENT;
+	}
+	return record->crc == record_crc(record) ? 0 : -EBADMSG;
+}
+
+static int find_sector(uint32_t seq)
+{
+	for (int i = 0; i < SECTOR_COUNT; i++)
+	{
+		if (sectors[i].seq != SECTOR_INVALID && sectors[i].seq == seq)
+		{
+			return i;
+		}
+	}
+	return -ENOENT;
+}
+
+static uint32_t oldest_seq(void)
+{
+	uint32_t oldest = sectors[head_sector].seq;
+
+	for (int i = 0; i < SECTOR_COUNT; i++)
+	{
+		if (sectors[i].seq != SECTOR_INVALID && sectors[i].seq < oldest)
+		{
+			oldest = sectors[i].seq;
+		}
+	}
+	return oldest;
+}
+
+static int open_sector(uint16_t sector, uint32_t seq)
+{
+	struct sector_header header = {
+		.magic = SECTOR_MAGIC,
+		.seq = seq,
+		.version = SECTOR_VERSION,
+		.record_size = RECORD_SIZE,
+	};
+	int err;
+
+	/* The index entry goes first, so a failed erase never leaves a stale
+	 * sequence number behind.
+	 */
+	sectors[sector].seq = SECTOR_INVALID;
+	sectors[sector].first_ts = NO_TIMESTAMP;
+
+	err = flash_area_erase(fa, (off_t)sector * SECTOR_SIZE, SECTOR_SIZE);
+	if (err)
+	{
+		return err;
+	}
+
+	memset(header.reserved, 0xff, sizeof(header.reserved));
+	header.crc = crc32_ieee((const uint8_t *)&header, offsetof(struct sector_header, crc));
+	err = flash_area_write(fa, (off_t)sector * SECTOR_SIZE, &header, sizeof(header));
+	if (err)
+	{
+		return err;
+	}
+
+	sectors[sector].seq = seq;
+	head_sector = sector;
+	head_slot = 0;
+	return 0;
+}
+
+static int scan_sector(uint16_t sector)
+{
+	struct sector_header header;
+	struct telemetry_record record;
+	int err;
+
+	sectors[sector].seq = SECTOR_INVALID;
+	sectors[sector].first_ts = NO_TIMESTAMP;
+
+	err = flash_area_read(fa, (off_t)sector * SECTOR_SIZE, &header, sizeof(header));
+	if (err)
+	{
+		return err;
+	}
+	if (header.magic != SECTOR_MAGIC || header.version != SECTOR_VERSION ||
+		header.record_size != RECORD_SIZE || header.seq == SECTOR_INVALID ||
+		header.crc != crc32_ieee((const uint8_t *)&header, offsetof(struct sector_header, crc)))
+	{
+		return 0;
+	}
+	sectors[sector].seq = header.seq;
+
+	for (uint16_t slot = 0; slot < SECTOR_SLOTS; slot++)
+	{
+		err = read_record(sector, slot, &record);
+		if (err == -ENOENT)
+		{
+			break;
+		}
+		if (err == 0)
+		{
+			sectors[sector].first_ts = record.timestamp;
+			break;
+		}
+	}
+	return 0;
+}
+
+/* Finds the first erased slot of the head sector and the last valid record,
+ * looking into the previous sector if the head sector has none.
+ */
+static int recover_head(void)
+{
+	struct telemetry_record record;
+	bool found = false;
+	int sector = head_sector;
+	int err;
+
+	head_slot = SECTOR_SLOTS;
+	while (head_slot > 0)
+	{
+		err = read_record(head_sector, head_slot - 1, &record);
+		if (err != -ENOENT)
+		{
+			break;
+		}
+		head_slot--;
+	}
+
+	for (int n = 0; n < 2 && !found && sector >= 0; n++)
+	{
+		for (int slot = SECTOR_SLOTS - 1; slot >= 0; slot--)
+		{
+			err = read_record(sector, slot, &record);
+			if (err == 0)
+			{
+				found = true;
+				break;
+			}
+			if (err != -ENOENT && err != -EBADMSG)
+			{
+				return err;
+			}
+		}
+		sector = find_sector(sectors[head_sector].seq - 1);
+	}
+
+	if (found)
+	{
+		next_seq = record.seq + 1;
+		time_base = record.timestamp + 1;
+	}
+	return 0;
+}
+
+int telemetry_log_init(void)
+{
+	struct flash_pages_info info;
+	int head = -1;
+	int err;
+
+	err = flash_area_open(LOG_PARTITION_ID, &fa);
+	if (err)
+	{
+		LOG_ERR("Failed to open the telemetry partition (err %d)", err);
+		return err;
+	}
+
+	err = flash_get_page_info_by_offs(flash_area_get_device(fa), fa->fa_off, &info);
+	if (err || info.size != SECTOR_SIZE)
+	{
+		LOG_ERR("Telemetry log sector size mismatch");
+		flash_area_close(fa);
+		fa = NULL;
+		return err ? err : -EINVAL;
+	}
+
+	k_mutex_lock(&log_mutex, K_FOREVER);
+
+	next_seq = 0;
+	time_base = 0;
+	batch_count = 0;
+
+	for (int i = 0; i < SECTOR_COUNT; i++)
+	{
+		err = scan_sector(i);
+		if (err)
+		{
+			goto unlock;
+		}
+		if (sectors[i].seq != SECTOR_INVALID &&
+			(head < 0 || sectors[i].seq > sectors[head].seq))
+		{
+			head = i;
+		}
+	}
+
+	if (head < 0)
+	{
+		LOG_INF("Starting a new telemetry log");
+		err = open_sector(0, 1);
+		goto unlock;
+	}
+
+	head_sector = head;
+	err = recover_head();
+	if (err)
+	{
+		goto unlock;
+	}
+
+	LOG_INF("Telemetry log: record %u, time %u s, sector %u slot %u",
+			next_seq, time_base, head_sector, head_slot);
+
+unlock:
+	if (err)
+	{
+		LOG_ERR("Telemetry log init failed (err %d)", err);
+		flash_area_close(fa);
+		fa = NULL;
+	}
+	k_mutex_unlock(&log_mutex);
+	return err;
+}
+
+uint32_t telemetry_log_time(void)
+{
+	return time_base + (uint32_t)(k_uptime_get() / MSEC_PER_SEC);
+}
+
+static int flush_locked(void)
+{
+	uint16_t written = 0;
+	int err = 0;
+
+	while (written < batch_count)
+	{
+		if (head_slot >= SECTOR_SLOTS)
+		{
+			/* Sectors are used in turn, so the next one holds the oldest
+			 * records and every sector wears at the same rate.
+			 */
+			err = open_sector((head_sector + 1) % SECTOR_COUNT,
+							  sectors[head_sector].seq + 1);
+			if (err)
+			{
+				break;
+			}
+		}
+
+		uint16_t count = MIN(batch_count - written, (int)(SECTOR_SLOTS - head_slot));
+
+		err = flash_area_write(fa, slot_offset(head_sector, head_slot), &batch[written],
+							   count * RECORD_SIZE);
+		if (err)
+		{
+			break;
+		}
+		if (sectors[head_sector].first_ts == NO_TIMESTAMP)
+		{
+			sectors[head_sector].first_ts = batch[written].timestamp;
+		}
+		head_slot += count;
+		written += count;
+	}
+
+	if (err)
+	{
+		LOG_ERR("Telemetry log write failed (err %d), %u records lost",
+				err, batch_count - written);
+	}
+	batch_count = 0;
+	return err;
+}
+
+int telemetry_log_append(struct telemetry_record *record)
+{
+	int err = 0;
+
+	if (!fa)
+	{
+		return -ENODEV;
+	}
+
+	k_mutex_lock(&log_mutex, K_FOREVER);
+
+	record->seq = next_seq++;
+	record->timestamp = telemetry_log_time();
+	memset(record->reserved, 0xff, sizeof(record->reserved));
+	record->crc = record_crc(record);
+
+	batch[batch_count++] = *record;
+	if (batch_count == BATCH_SIZE)
+	{
+		err = flush_locked();
+	}
+
+	k_mutex_unlock(&log_mutex);
+	return err;
+}
+
+int telemetry_log_flush(void)
+{
+	int err;
+
+	if (!fa)
+	{
+		return -ENODEV;
+	}
+
+	k_mutex_lock(&log_mutex, K_FOREVER);
+	err = flush_locked();
+	k_mutex_unlock(&log_mutex);
+	return err;
+}
+
+int telemetry_log_iter_init(struct telemetry_log_iter *iter, uint32_t since)
+{
+	int start = -1;
+
+	if (!fa)
+	{
+		return -ENODEV;
+	}
+
+	k_mutex_lock(&log_mutex, K_FOREVER);
+
+	/* Last sector starting before since, the records before since are
+	 * skipped by telemetry_log_iter_next(). A sector starting at since may
+	 * follow records at since in the previous one.
+	 */
+	for (int i = 0; i < SECTOR_COUNT; i++)
+	{
+		if (sectors[i].seq == SECTOR_INVALID || sectors[i].first_ts == NO_TIMESTAMP ||
+			sectors[i].first_ts >= since)
+		{
+			continue;
+		}
+		if (start < 0 || sectors[i].seq > sectors[start].seq)
+		{
+			start = i;
+		}
+	}
+
+	iter->sector_seq = start < 0 ? oldest_seq() : sectors[start].seq;
+	iter->since = since;
+	iter->slot = 0;
+	iter->skipped_records = 0;
+
+	k_mutex_unlock(&log_mutex);
+	return 0;
+}
+
+int telemetry_log_iter_next(struct telemetry_log_iter *iter, struct telemetry_record *record)
+{
+	int err = -ENODATA;
+
+	if (!fa)
+	{
+		return -ENODEV;
+	}
+
+	k_mutex_lock(&log_mutex, K_FOREVER);
+
+	while (iter->sector_seq <= sectors[head_sector].seq)
+	{
+		int sector = find_sector(iter->sector_seq);
+
+		if (sector < 0)
+		{
+			/* Erased for new records since the last call */
+			uint32_t oldest = oldest_seq();
+
+			if (iter->sector_seq < oldest)
+			{
+				iter->skipped_records += (oldest - iter->sector_seq) * SECTOR_SLOTS -
+										 iter->slot;
+				iter->sector_seq = oldest;
+			}
+			else
+			{
+				iter->sector_seq++;
+			}
+			iter->slot = 0;
+			continue;
+		}
+
+		uint16_t end = sector == head_sector ? head_slot : SECTOR_SLOTS;
+
+		if (iter->slot >= end)
+		{
+			if (sector == head_sector)
+			{
+				break;
+			}
+			iter->sector_seq++;
+			iter->slot = 0;
+			continue;
+		}
+
+		err = read_record(sector, iter->slot, record);
+		iter->slot++;
+		if (err == 0 && record->timestamp >= iter->since)
+		{
+			break;
+		}
+		if (err != 0 && err != -ENOENT && err != -EBADMSG)
+		{
+			break;
+		}
+		err = -ENODATA;
+	}
+
+	k_mutex_unlock(&log_mutex);
+	return err;
+}
@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2025 Grovety Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <zephyr/toolchain.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /** Battery level of the records logged before the battery was sampled. */
+#define TELEMETRY_LOG_BATTERY_UNKNOWN 0xff
+
+    /**
+     * @brief One sample as stored in the telemetry log, 32 bytes.
+     */
+    struct telemetry_record
+    {
+        /** Record sequence number, set by the log. */
+        uint32_t seq;
+        /** Log time in seconds, set by the log. It only advances while the
+         *  device is powered, and carries on from the last record after a
+         *  reboot. */
+        uint32_t timestamp;
+        /** Temperature, in 0.01 degrees Celsius. */
+        int16_t temperature;
+        /** Humidity, in 0.01 percent. */
+        uint16_t humidity;
+        /** Pressure, in Pa. */
+        uint32_t pressure;
+        /** CO2, in ppm. */
+        uint16_t co2;
+        /** VOC, in ppb. */
+        uint16_t voc;
+        /** IAQ index. */
+        uint16_t iaq;
+        /** Battery level, in percent, or TELEMETRY_LOG_BATTERY_UNKNOWN. */
+        uint8_t battery;
+        /** BSEC accuracy and status, as in the sensor record. */
+        uint8_t status;
+        uint8_t reserved[4];
+        /** CRC32 of the fields above, set by the log. */
+        uint32_t crc;
+    } __packed;
+
+    /**
+     * @brief Reader of the telemetry log. Fields are private, except
+     *  skipped_records.
+     */
+    struct telemetry_log_iter
+    {
+        uint32_t sector_seq;
+        uint32_t since;
+        uint16_t slot;
+        /** Records overwritten before they were read. */
+        uint32_t skipped_records;
+    };
+
+    /**
+     * @brief Mounts the telemetry log, recovering the write position after a
+     *  reset or power loss. Starts a new log if the partition holds none.
+     *
+     * @return 0 if success, error code if failure.
+     */
+    int telemetry_log_init(void);
+
+    /**
+     * @brief Appends a record to the log.
+     *
+     * Records are held in RAM and written in batches of
+     * CONFIG_APP_TELEMETRY_LOG_BATCH. The oldest sector is erased when the
+     * partition is full.
+     *
+     * @param record Record with the measured values. seq, timestamp and crc
+     *  are filled in.
+     *
+     * @return 0 if success, error code if failure.
+     */
+    int telemetry_log_append(struct telemetry_record *record);
+
+    /**
+     * @brief Writes the records held in RAM to flash.
+     *
+     * @return 0 if success, error code if failure.
+     */
+    int telemetry_log_flush(void);
+
+    /**
+     * @brief Provides the log time, the timestamp a record appended now gets.
+     *
+     * @return Log time in seconds.
+     */
+    uint32_t telemetry_log_time(void);
+
+    /**
+     * @brief Starts reading the log.
+     *
+     * Seeks with the index of the first timestamp of each sector, then
+     * within the sector.
+     *
+     * @param iter Iterator to initialize.
+     * @param since Log time in seconds of the first record to read.
+     *
+     * @return 0 if success, error code if failure.
+     */
+    int telemetry_log_iter_init(struct telemetry_log_iter *iter, uint32_t since);
+
+    /**
+     * @brief Reads the next record in flash, oldest first. Records with a
+     *  bad CRC are skipped.
+     *
+     * @param iter Iterator.
+     * @param record Record read.
+     *
+     * @return 0 if a record was read, -ENODATA if there are no more records,
+     *  other error code if failure.
+     */
+    int telemetry_log_iter_next(struct telemetry_log_iter *iter, struct telemetry_record *record);
+
+#ifdef __cplusplus
+}
+#endif
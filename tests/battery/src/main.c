@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2025 Grovety Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/drivers/adc/adc_emul.h>
+#include <zephyr/drivers/gpio.h>
+#include <zephyr/drivers/gpio/gpio_emul.h>
+#include <zephyr/kernel.h>
+#include <zephyr/ztest.h>
+
+#include "battery.h"
+
+#define VBATT DT_PATH(vbatt)
+#define ADC_CHANNEL DT_IO_CHANNELS_INPUT(VBATT)
+
+/* The divider halves the battery voltage */
+#define DIVIDER_RATIO 2
+/* ADC quantization error on the battery voltage */
+#define TOLERANCE_MV 4
+
+static const struct device *const adc = DEVICE_DT_GET(DT_IO_CHANNELS_CTLR(VBATT));
+static const struct gpio_dt_spec power = GPIO_DT_SPEC_GET(VBATT, power_gpios);
+
+/* Voltages at the ADC input, one per conversion in turn */
+static const uint32_t input_mV[] = {1000, 1200, 1400, 1600};
+
+static int conversions;
+static int unpowered_conversions;
+static int64_t first_conversion_ticks;
+/* Conversions wait on this while stall is set */
+static bool stall;
+static K_SEM_DEFINE(stall_sem, 0, 1);
+
+static int adc_input(const struct device *dev, unsigned int chan, void *data, uint32_t *result)
+{
+	ARG_UNUSED(dev);
+	ARG_UNUSED(chan);
+	ARG_UNUSED(data);
+
+	if (stall)
+	{
+		/* runs in the ADC emulator thread, the read times out meanwhile */
+		k_sem_take(&stall_sem, K_FOREVER);
+	}
+	if (conversions == 0)
+	{
+		first_conversion_ticks = k_uptime_ticks();
+	}
+	if (gpio_emul_output_get(power.port, power.pin) != 1)
+	{
+		unpowered_conversions++;
+	}
+	*result = input_mV[conversions % ARRAY_SIZE(input_mV)];
+	conversions++;
+	return 0;
+}
+
+static void *setup(void)
+{
+	zassert_true(device_is_ready(adc));
+	zassert_ok(adc_emul_value_func_set(adc, ADC_CHANNEL, adc_input, NULL));
+	return NULL;
+}
+
+static void before(void *fixture)
+{
+	ARG_UNUSED(fixture);
+
+	conversions = 0;
+	unpowered_conversions = 0;
+}
+
+ZTEST(battery, test_divider_off_at_boot)
+{
+	zassert_equal(gpio_emul_output_get(power.port, power.pin), 0);
+}
+
+ZTEST(battery, test_divider_powered_around_sample)
+{
+	int64_t start = k_uptime_ticks();
+	int mV = battery_sample();
+
+	zassert_true(mV > 0, "sample failed: %d", mV);
+	zassert_equal(conversions, CONFIG_APP_BATTERY_SAMPLE_COUNT);
+	zassert_equal(unpowered_conversions, 0, "ADC read with the divider off");
+	zassert_equal(gpio_emul_output_get(power.port, power.pin), 0,
+				  "divider left powered");
+
+	/* the divider settles before the first conversion */
+	zassert_true(first_conversion_ticks - start >=
+					 k_us_to_ticks_floor64(CONFIG_APP_BATTERY_SETTLE_TIME_US));
+}
+
+ZTEST(battery, test_averaging)
+{
+	uint32_t sum = 0;
+	int mV;
+
+	for (int i = 0; i < CONFIG_APP_BATTERY_SAMPLE_COUNT; i++)
+	{
+		sum += input_mV[i % ARRAY_SIZE(input_mV)];
+	}
+
+	mV = battery_sample();
+	zassert_within(mV, sum * DIVIDER_RATIO / CONFIG_APP_BATTERY_SAMPLE_COUNT, TOLERANCE_MV);
+}
+
+/* A conversion that times out leaves the divider powered, and the samples
+ * taken before it completes return without waiting for it
+ */
+ZTEST(battery, test_conversion_timeout)
+{
+	int64_t start;
+	int mV;
+
+	stall = true;
+	zassert_equal(battery_sample(), -ETIMEDOUT);
+	zassert_equal(gpio_emul_output_get(power.port, power.pin), 1,
+				  "divider powered off under a pending conversion");
+
+	start = k_uptime_get();
+	zassert_equal(battery_sample(), -EBUSY);
+	zassert_true(k_uptime_get() - start < 10, "sample waited for the pending conversion");
+	zassert_equal(gpio_emul_output_get(power.port, power.pin), 1);
+
+	/* the pending conversion completes, the next sample runs in full */
+	stall = false;
+	k_sem_give(&stall_sem);
+	k_sleep(K_MSEC(10));
+	conversions = 0;
+	unpowered_conversions = 0;
+
+	mV = battery_sample();
+	zassert_true(mV > 0, "sample failed: %d", mV);
+	zassert_equal(conversions, CONFIG_APP_BATTERY_SAMPLE_COUNT);
+	zassert_equal(unpowered_conversions, 0);
+	zassert_equal(gpio_emul_output_get(power.port, power.pin), 0,
+				  "divider left powered");
+}
+
+ZTEST_SUITE(battery, NULL, setup, before, NULL, NULL);
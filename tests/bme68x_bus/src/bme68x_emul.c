@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2025 Grovety Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#define DT_DRV_COMPAT bosch_bme680
+
+#include <string.h>
+
+#include <zephyr/device.h>
+#include <zephyr/drivers/emul.h>
+#include <zephyr/drivers/i2c.h>
+#include <zephyr/drivers/i2c_emul.h>
+#include <zephyr/kernel.h>
+
+#include "bme68x_defs.h"
+#include "bme68x_emul.h"
+
+/* Nanoseconds on the wire per byte, with its acknowledge bit */
+#define BYTE_NS (9 * (NSEC_PER_SEC / BME68X_EMUL_I2C_HZ))
+
+/* Calibration blocks read by bme68x_init() */
+#define COEFF1_REG 0x8A
+#define COEFF1_LEN 23
+#define COEFF2_REG 0xE1
+#define COEFF2_LEN 14
+#define COEFF3_REG 0x00
+#define COEFF3_LEN 5
+
+static uint8_t regs[256];
+static int hidden_reads;
+
+void bme68x_emul_reset(void)
+{
+	memset(regs, 0, sizeof(regs));
+	/* any non zero calibration keeps the compensation from dividing by
+	 * zero
+	 */
+	memset(&regs[COEFF1_REG], 0x40, COEFF1_LEN);
+	memset(&regs[COEFF2_REG], 0x40, COEFF2_LEN);
+	memset(&regs[COEFF3_REG], 0x40, COEFF3_LEN);
+	regs[BME68X_REG_CHIP_ID] = BME68X_CHIP_ID;
+	regs[BME68X_REG_VARIANT_ID] = BME68X_VARIANT_GAS_LOW;
+	hidden_reads = 0;
+}
+
+void bme68x_emul_set_field(uint8_t index, bool new_data, uint8_t meas_index)
+{
+	uint8_t *field = &regs[BME68X_REG_FIELD0 + index * BME68X_LEN_FIELD_OFFSET];
+
+	memset(field, 0x80, BME68X_LEN_FIELD);
+	field[0] = (new_data ? BME68X_NEW_DATA_MSK : 0) | index;
+	field[1] = meas_index;
+}
+
+void bme68x_emul_new_data_after(int reads)
+{
+	hidden_reads = reads;
+}
+
+/* Writes are register and value pairs, the first register being the
+ * address byte of the transfer
+ */
+static void write_regs(const uint8_t *buf, uint32_t len)
+{
+	for (uint32_t i = 0; i + 1 < len; i += 2) {
+		regs[buf[i]] = buf[i + 1];
+	}
+}
+
+static void read_regs(uint8_t reg, uint8_t *buf, uint32_t len)
+{
+	for (uint32_t i = 0; i < len; i++) {
+		buf[i] = regs[(uint8_t)(reg + i)];
+	}
+
+	if (hidden_reads > 0 && reg == BME68X_REG_FIELD0) {
+		hidden_reads--;
+		for (uint32_t i = 0; i < len; i += BME68X_LEN_FIELD_OFFSET) {
+			buf[i] &= ~BME68X_NEW_DATA_MSK;
+		}
+	}
+}
+
+static int emul_transfer(const struct emul *target, struct i2c_msg *msgs, int num_msgs,
+			 int addr)
+{
+	uint8_t written[64];
+	uint32_t written_len = 0;
+	uint32_t bytes = 0;
+
+	ARG_UNUSED(target);
+	ARG_UNUSED(addr);
+
+	for (int i = 0; i < num_msgs; i++) {
+		/* address byte of the start or restart */
+		if (i == 0 || (msgs[i].flags & I2C_MSG_RESTART) ||
+		    (msgs[i].flags & I2C_MSG_RW_MASK) != (msgs[i - 1].flags & I2C_MSG_RW_MASK)) {
+			bytes++;
+		}
+		bytes += msgs[i].len;
+
+		if ((msgs[i].flags & I2C_MSG_RW_MASK) == I2C_MSG_READ) {
+			if (written_len == 0) {
+				return -EIO;
+			}
+			read_regs(written[0], msgs[i].buf, msgs[i].len);
+			continue;
+		}
+
+		if (written_len + msgs[i].len > sizeof(written)) {
+			return -EIO;
+		}
+		memcpy(&written[written_len], msgs[i].buf, msgs[i].len);
+		written_len += msgs[i].len;
+	}
+	write_regs(written, written_len);
+
+	k_busy_wait(DIV_ROUND_UP(bytes * BYTE_NS, NSEC_PER_USEC));
+	return 0;
+}
+
+static const struct i2c_emul_api emul_api = {
+	.transfer = emul_transfer,
+};
+
+static int emul_init(const struct emul *target, const struct device *parent)
+{
+	ARG_UNUSED(target);
+	ARG_UNUSED(parent);
+
+	bme68x_emul_reset();
+	return 0;
+}
+
+/* The emulator is bound to the device of its node, which has no driver here */
+DEVICE_DT_INST_DEFINE(0, NULL, NULL, NULL, NULL, POST_KERNEL, CONFIG_KERNEL_INIT_PRIORITY_DEVICE,
+		      NULL);
+EMUL_DT_INST_DEFINE(0, emul_init, NULL, NULL, &emul_api, NULL);
@@ -0,0 +1,36 @@
+/*
+ * Copyright (c) 2025 Grovety Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* I2C clock the emulator spends the wire time of the transfers at */
+#define BME68X_EMUL_I2C_HZ 400000
+
+/**
+ * @brief Restores the registers of a device just measured: chip id,
+ *  calibration and empty measurement fields.
+ */
+void bme68x_emul_reset(void);
+
+/**
+ * @brief Fills a measurement field of the register map.
+ *
+ * @param index Field 0 to 2
+ * @param new_data Whether the field holds a measurement not read yet
+ * @param meas_index Index of the measurement in the sequence
+ */
+void bme68x_emul_set_field(uint8_t index, bool new_data, uint8_t meas_index);
+
+/**
+ * @brief Hides the new data flags from the next reads of the fields, as if
+ *  the measurement was still running.
+ *
+ * @param reads Reads of the fields before the flags show
+ */
+void bme68x_emul_new_data_after(int reads);
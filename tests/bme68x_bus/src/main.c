@@ -0,0 +1,202 @@
+/*
+ * Copyright (c) 2025 Grovety Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+
+#include <zephyr/drivers/i2c.h>
+#include <zephyr/kernel.h>
+#include <zephyr/ztest.h>
+
+#include "bme68x.h"
+#include "bme68x_emul.h"
+#include "bme68x_iaq_bus.h"
+
+#define BME68X_NODE DT_NODELABEL(bme68x)
+
+/* Register blocks bme68x_get_data() reads per sample */
+#define FORCED_TRANSACTIONS 4
+#define PARALLEL_TRANSACTIONS 2
+
+#define BENCHMARK_SAMPLES 100
+
+static const struct i2c_dt_spec i2c = I2C_DT_SPEC_GET(BME68X_NODE);
+
+#if CONFIG_BME68X_IAQ_RTIO
+RTIO_DEFINE(test_rtio, 8, 8);
+I2C_DT_IODEV_DEFINE(test_iodev, BME68X_NODE);
+#endif
+
+static struct bme68x_iaq_bus bus;
+static struct bme68x_dev dev;
+
+/* Callbacks of the bme68x driver, as bme68x_iaq.c sets them */
+static int8_t bus_write(uint8_t reg_addr, const uint8_t *reg_data_ptr, uint32_t len,
+			void *intf_ptr)
+{
+	return bme68x_iaq_bus_write(intf_ptr, reg_addr, reg_data_ptr, len);
+}
+
+static int8_t bus_read(uint8_t reg_addr, uint8_t *reg_data_ptr, uint32_t len, void *intf_ptr)
+{
+	return bme68x_iaq_bus_read(intf_ptr, reg_addr, reg_data_ptr, len);
+}
+
+static void delay_us(uint32_t period, void *intf_ptr)
+{
+	bme68x_iaq_bus_release(intf_ptr);
+	k_usleep((int32_t)period);
+}
+
+/* Read a sample as fetch_and_process_output() does */
+static int get_data(uint8_t op_mode, struct bme68x_data *data, uint8_t *n_fields)
+{
+	int ret;
+
+	bus.transactions = 0;
+	bus.submissions = 0;
+	(void)bme68x_iaq_bus_prefetch(&bus, op_mode);
+	ret = bme68x_get_data(op_mode, data, n_fields, &dev);
+	bme68x_iaq_bus_release(&bus);
+	return ret;
+}
+
+static void *setup(void)
+{
+	zassert_true(i2c_is_ready_dt(&i2c));
+
+	bus.i2c = &i2c;
+#if CONFIG_BME68X_IAQ_RTIO
+	bus.rtio = &test_rtio;
+	bus.iodev = &test_iodev;
+#endif
+
+	dev.intf = BME68X_I2C_INTF;
+	dev.intf_ptr = &bus;
+	dev.read = bus_read;
+	dev.write = bus_write;
+	dev.delay_us = delay_us;
+	dev.amb_temp = 25;
+	zassert_equal(bme68x_init(&dev), BME68X_OK);
+	return NULL;
+}
+
+static void before(void *fixture)
+{
+	ARG_UNUSED(fixture);
+
+	bme68x_emul_reset();
+	bme68x_iaq_bus_release(&bus);
+}
+
+/* Bus cost of a forced mode sample, the mode the BSEC configuration uses.
+ * The emulator spends the wire time at 400 kHz, the rest of the cycles is
+ * the cost of the transport. native_sim does not count the thread switches
+ * to the RTIO work queue, compare the submissions, the caller waits once per
+ * submission on the target.
+ */
+ZTEST(bme68x_bus, test_forced_benchmark)
+{
+	struct bme68x_data data[3];
+	uint32_t transactions = 0;
+	uint32_t submissions = 0;
+	uint32_t cycles = 0;
+	uint8_t n_fields;
+
+	for (int i = 0; i < BENCHMARK_SAMPLES; i++) {
+		uint32_t start;
+
+		bme68x_emul_set_field(0, true, i);
+		start = k_cycle_get_32();
+		zassert_equal(get_data(BME68X_FORCED_MODE, data, &n_fields), BME68X_OK);
+		cycles += k_cycle_get_32() - start;
+		zassert_equal(n_fields, 1);
+
+		transactions += bus.transactions;
+		submissions += bus.submissions;
+	}
+
+	TC_PRINT("%s: %u transactions, %u submissions, %u cycles per sample\n",
+		 IS_ENABLED(CONFIG_BME68X_IAQ_RTIO) ? "rtio" : "i2c",
+		 transactions / BENCHMARK_SAMPLES, submissions / BENCHMARK_SAMPLES,
+		 cycles / BENCHMARK_SAMPLES);
+
+	zassert_equal(transactions, FORCED_TRANSACTIONS * BENCHMARK_SAMPLES);
+	zassert_equal(submissions,
+		      (IS_ENABLED(CONFIG_BME68X_IAQ_RTIO) ? 1 : FORCED_TRANSACTIONS) *
+			      BENCHMARK_SAMPLES);
+}
+
+ZTEST(bme68x_bus, test_parallel_fields)
+{
+	struct bme68x_data data[3];
+	uint8_t n_fields;
+
+	for (uint8_t i = 0; i < 3; i++) {
+		bme68x_emul_set_field(i, true, i);
+	}
+
+	zassert_equal(get_data(BME68X_PARALLEL_MODE, data, &n_fields), BME68X_OK);
+	zassert_equal(n_fields, 3);
+	zassert_equal(bus.transactions, PARALLEL_TRANSACTIONS);
+	zassert_equal(bus.submissions,
+		      IS_ENABLED(CONFIG_BME68X_IAQ_RTIO) ? 1 : PARALLEL_TRANSACTIONS);
+}
+
+/* The sample read ahead is the sample read register by register */
+ZTEST(bme68x_bus, test_prefetch_matches_direct_read)
+{
+	struct bme68x_data prefetched;
+	struct bme68x_data direct;
+	uint8_t n_fields;
+
+	bme68x_emul_set_field(0, true, 7);
+	zassert_equal(get_data(BME68X_FORCED_MODE, &prefetched, &n_fields), BME68X_OK);
+	zassert_equal(bme68x_get_data(BME68X_FORCED_MODE, &direct, &n_fields, &dev), BME68X_OK);
+
+	zassert_equal(prefetched.meas_index, direct.meas_index);
+	zassert_equal(prefetched.temperature, direct.temperature);
+	zassert_equal(prefetched.pressure, direct.pressure);
+	zassert_equal(prefetched.humidity, direct.humidity);
+	zassert_equal(prefetched.gas_resistance, direct.gas_resistance);
+	zassert_equal(prefetched.res_heat, direct.res_heat);
+	zassert_equal(prefetched.idac, direct.idac);
+	zassert_equal(prefetched.gas_wait, direct.gas_wait);
+}
+
+ZTEST(bme68x_bus, test_write_releases_prefetch)
+{
+	uint8_t reg = BME68X_REG_GAS_WAIT0;
+	uint8_t value = 0x59;
+	uint8_t read;
+
+	Z_TEST_SKIP_IFNDEF(CONFIG_BME68X_IAQ_RTIO);
+
+	zassert_ok(bme68x_iaq_bus_prefetch(&bus, BME68X_FORCED_MODE));
+	zassert_ok(bme68x_iaq_bus_write(&bus, reg, &value, sizeof(value)));
+
+	bus.transactions = 0;
+	zassert_ok(bme68x_iaq_bus_read(&bus, reg, &read, sizeof(read)));
+	zassert_equal(read, value);
+	zassert_equal(bus.transactions, 1);
+}
+
+/* The driver waits for a measurement still running, the registers read
+ * ahead before the wait must not be served after it
+ */
+ZTEST(bme68x_bus, test_new_data_after_delay)
+{
+	struct bme68x_data data;
+	uint8_t n_fields;
+
+	bme68x_emul_set_field(0, true, 3);
+	bme68x_emul_new_data_after(1);
+
+	zassert_equal(get_data(BME68X_FORCED_MODE, &data, &n_fields), BME68X_OK);
+	zassert_equal(n_fields, 1);
+	zassert_equal(data.meas_index, 3);
+}
+
+ZTEST_SUITE(bme68x_bus, NULL, setup, before, NULL, NULL);
@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2025 Grovety Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/ztest.h>
+
+static void read_hook(void);
+
+#define BME68X_IAQ_OUTPUT_READ_HOOK() read_hook()
+#include "bme68x_iaq_output.h"
+
+#define WRITER_STACK_SIZE 1024
+#define STRESS_READS 1000000
+
+static struct bme68x_iaq_output output;
+
+/* Samples published by read_hook(), the next time it runs */
+static int hook_publishes;
+static int hook_calls;
+static uint32_t next_value;
+
+static K_THREAD_STACK_DEFINE(writer_stack, WRITER_STACK_SIZE);
+static struct k_thread writer_thread;
+static atomic_t writer_stop;
+
+/* Every field of a sample holds the same value, so a sample mixing two
+ * publications is detected.
+ */
+static void publish(void)
+{
+	uint32_t value = ++next_value;
+	struct bme_sample_result sample = {
+		.temperature = (float)value,
+		.humidity = (float)value,
+		.pressure = (float)value,
+		.air_quality = (uint16_t)value,
+		.co2 = (float)value,
+		.voc = (float)value,
+		.timestamp_ms = value,
+	};
+
+	bme68x_iaq_output_publish(&output, &sample);
+}
+
+static void assert_consistent(const struct bme_sample_result *sample)
+{
+	float value = (float)sample->timestamp_ms;
+
+	zassert_equal(sample->temperature, value);
+	zassert_equal(sample->humidity, value);
+	zassert_equal(sample->pressure, value);
+	zassert_equal(sample->air_quality, (uint16_t)sample->timestamp_ms);
+	zassert_equal(sample->co2, value);
+	zassert_equal(sample->voc, value);
+}
+
+/* Stands for a writer preempting the reader after its copy */
+static void read_hook(void)
+{
+	hook_calls++;
+	for (; hook_publishes > 0; hook_publishes--) {
+		publish();
+	}
+}
+
+static void before(void *fixture)
+{
+	ARG_UNUSED(fixture);
+
+	memset(&output, 0, sizeof(output));
+	next_value = 0;
+	hook_publishes = 0;
+	hook_calls = 0;
+}
+
+ZTEST(bsec_output, test_nothing_published)
+{
+	zassert_false(bme68x_iaq_output_available(&output));
+	publish();
+	zassert_true(bme68x_iaq_output_available(&output));
+}
+
+ZTEST(bsec_output, test_read_latest)
+{
+	struct bme_sample_result sample;
+
+	for (int i = 0; i < 3; i++) {
+		publish();
+		bme68x_iaq_output_read(&output, &sample);
+		assert_consistent(&sample);
+		zassert_equal(sample.timestamp_ms, next_value);
+	}
+	zassert_equal(hook_calls, 3);
+}
+
+ZTEST(bsec_output, test_publish_during_read)
+{
+	struct bme_sample_result sample;
+
+	publish();
+	/* the other buffer is written, the copy is retried for the newer sample */
+	hook_publishes = 1;
+	bme68x_iaq_output_read(&output, &sample);
+	assert_consistent(&sample);
+	zassert_equal(sample.timestamp_ms, 2);
+	zassert_equal(hook_calls, 2);
+}
+
+ZTEST(bsec_output, test_buffer_reused_during_read)
+{
+	struct bme_sample_result sample;
+
+	publish();
+	/* the second sample reuses the buffer being copied */
+	hook_publishes = 2;
+	bme68x_iaq_output_read(&output, &sample);
+	assert_consistent(&sample);
+	zassert_equal(sample.timestamp_ms, 3);
+	zassert_equal(hook_calls, 2);
+}
+
+static void writer(void *p1, void *p2, void *p3)
+{
+	ARG_UNUSED(p1);
+	ARG_UNUSED(p2);
+	ARG_UNUSED(p3);
+
+	while (!atomic_get(&writer_stop)) {
+		publish();
+		if (!IS_ENABLED(CONFIG_SMP)) {
+			/* on a single CPU, let the reader run between samples */
+			k_yield();
+		}
+	}
+}
+
+ZTEST(bsec_output, test_concurrent_writer)
+{
+	struct bme_sample_result sample;
+	int64_t last = 0;
+	uint32_t changes = 0;
+
+	publish();
+	atomic_set(&writer_stop, 0);
+	k_thread_create(&writer_thread, writer_stack, K_THREAD_STACK_SIZEOF(writer_stack),
+			writer, NULL, NULL, NULL, k_thread_priority_get(k_current_get()), 0,
+			K_NO_WAIT);
+
+	for (int i = 0; i < STRESS_READS; i++) {
+		bme68x_iaq_output_read(&output, &sample);
+		assert_consistent(&sample);
+		/* samples are never read out of order */
+		zassert_true(sample.timestamp_ms >= last);
+		changes += sample.timestamp_ms != last;
+		last = sample.timestamp_ms;
+		if (!IS_ENABLED(CONFIG_SMP) && (i % 16) == 0) {
+			k_yield();
+		}
+	}
+
+	atomic_set(&writer_stop, 1);
+	k_thread_join(&writer_thread, K_FOREVER);
+	zassert_true(changes > 1, "writer did not run");
+}
+
+ZTEST_SUITE(bsec_output, NULL, NULL, before, NULL, NULL);
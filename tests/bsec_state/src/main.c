@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2025 Grovety Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/ztest.h>
+
+#include "bme68x_iaq_state.h"
+
+#define STATE_SIZE 64
+
+/* The two slots as stored by the settings backend */
+struct slot {
+	uint8_t buf[sizeof(struct bme68x_iaq_slot_header) + STATE_SIZE];
+	size_t len;
+};
+
+static struct slot slots[2];
+
+/* State loaded back, as kept by the driver */
+struct loaded {
+	uint32_t generation;
+	uint8_t state[STATE_SIZE];
+	size_t len;
+};
+
+static void make_state(uint8_t *state, uint32_t generation)
+{
+	for (int i = 0; i < STATE_SIZE; i++) {
+		state[i] = (uint8_t)(generation * 31 + i);
+	}
+}
+
+static struct slot *slot_get(uint32_t generation)
+{
+	return &slots[strcmp(bme68x_iaq_slot_name(generation), "1") == 0];
+}
+
+static void save(uint32_t generation)
+{
+	uint8_t state[STATE_SIZE];
+	struct slot *slot = slot_get(generation);
+
+	make_state(state, generation);
+	slot->len = bme68x_iaq_slot_build(slot->buf, generation, state, sizeof(state));
+	zassert_equal(slot->len, sizeof(slot->buf));
+}
+
+/* Feed a slot to the loader, as the settings load handler does */
+static void load_slot(struct loaded *loaded, const struct slot *slot)
+{
+	struct bme68x_iaq_slot_header header;
+	int ret;
+
+	if (slot->len == 0) {
+		return;
+	}
+	ret = bme68x_iaq_slot_check(slot->buf, slot->len, loaded->generation, &header);
+	if (ret <= 0) {
+		return;
+	}
+	zassert_equal(ret, STATE_SIZE);
+	memcpy(loaded->state, slot->buf + sizeof(header), ret);
+	loaded->len = ret;
+	loaded->generation = header.generation;
+}
+
+static void load(struct loaded *loaded, bool reversed)
+{
+	memset(loaded, 0, sizeof(*loaded));
+	load_slot(loaded, &slots[reversed ? 1 : 0]);
+	load_slot(loaded, &slots[reversed ? 0 : 1]);
+}
+
+static void assert_loaded(const struct loaded *loaded, uint32_t generation)
+{
+	uint8_t state[STATE_SIZE];
+
+	make_state(state, generation);
+	zassert_equal(loaded->generation, generation);
+	zassert_equal(loaded->len, STATE_SIZE);
+	zassert_mem_equal(loaded->state, state, STATE_SIZE);
+}
+
+static void before(void *fixture)
+{
+	ARG_UNUSED(fixture);
+
+	memset(slots, 0, sizeof(slots));
+}
+
+ZTEST(bsec_state, test_slots_alternate)
+{
+	/* each save goes to the slot not holding the current state */
+	for (uint32_t generation = 1; generation < 6; generation++) {
+		zassert_not_equal(slot_get(generation), slot_get(generation + 1));
+	}
+}
+
+ZTEST(bsec_state, test_newest_selected)
+{
+	struct loaded loaded;
+
+	for (uint32_t generation = 1; generation <= 5; generation++) {
+		save(generation);
+
+		/* whatever order the backend reports the slots in */
+		load(&loaded, false);
+		assert_loaded(&loaded, generation);
+		load(&loaded, true);
+		assert_loaded(&loaded, generation);
+	}
+}
+
+ZTEST(bsec_state, test_corrupted_slot)
+{
+	struct loaded loaded;
+
+	save(1);
+	save(2);
+	/* a bit of the newest state flipped */
+	slot_get(2)->buf[sizeof(struct bme68x_iaq_slot_header) + 10] ^= 0x04;
+
+	load(&loaded, false);
+	assert_loaded(&loaded, 1);
+	load(&loaded, true);
+	assert_loaded(&loaded, 1);
+}
+
+ZTEST(bsec_state, test_torn_slot)
+{
+	struct loaded loaded;
+
+	save(3);
+	save(4);
+	/* the newest write cut short by a power loss */
+	slot_get(4)->len -= 20;
+
+	load(&loaded, false);
+	assert_loaded(&loaded, 3);
+
+	/* only the header made it */
+	slot_get(4)->len = sizeof(struct bme68x_iaq_slot_header);
+	load(&loaded, true);
+	assert_loaded(&loaded, 3);
+
+	/* less than a header */
+	slot_get(4)->len = 6;
+	load(&loaded, false);
+	assert_loaded(&loaded, 3);
+}
+
+ZTEST(bsec_state, test_older_value_reported)
+{
+	struct loaded loaded;
+	struct slot old;
+
+	save(1);
+	old = *slot_get(1);
+	save(2);
+	save(3);
+
+	/* a backend reporting an old value of a slot after the current one */
+	load(&loaded, false);
+	load_slot(&loaded, &old);
+	assert_loaded(&loaded, 3);
+}
+
+ZTEST(bsec_state, test_foreign_value)
+{
+	struct loaded loaded;
+	struct bme68x_iaq_slot_header header;
+	uint8_t state[1] = {0};
+
+	save(1);
+	/* not a slot: wrong magic */
+	slot_get(1)->buf[0] ^= 0xff;
+	load(&loaded, false);
+	zassert_equal(loaded.generation, 0);
+	zassert_equal(bme68x_iaq_slot_check(slot_get(1)->buf, slot_get(1)->len, 0, &header),
+		      -EBADMSG);
+
+	/* an empty state */
+	slot_get(1)->len = bme68x_iaq_slot_build(slot_get(1)->buf, 1, state, 0);
+	zassert_equal(bme68x_iaq_slot_check(slot_get(1)->buf, slot_get(1)->len, 0, &header),
+		      -EBADMSG);
+}
+
+ZTEST_SUITE(bsec_state, NULL, NULL, before, NULL, NULL);
@@ -0,0 +1,301 @@
+/*
+ * Copyright (c) 2025 Grovety Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/ztest.h>
+
+#include "history.h"
+
+/* Enough samples to wrap the 1 KiB history several times */
+#define SAMPLE_COUNT 1000
+/* An hour of samples at the 3 s period of the default sample mode */
+#define BENCHMARK_COUNT 1200
+/* Gas outputs are refreshed every 300 s in that mode */
+#define GAS_PERIOD 100
+
+static struct history_sample samples[SAMPLE_COUNT];
+static struct history_sample benchmark_samples[BENCHMARK_COUNT];
+static uint32_t rng_state;
+
+static uint32_t rng(void)
+{
+	/* xorshift32, deterministic readings */
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 17;
+	rng_state ^= rng_state << 5;
+	return rng_state;
+}
+
+/* Readings like the sensor's: a steady period with some jitter, values that
+ * drift with noise, and gas values that are often repeated.
+ */
+static void make_samples(void)
+{
+	int64_t ts = 1000;
+
+	rng_state = 0x12345678;
+	for (int i = 0; i < SAMPLE_COUNT; i++)
+	{
+		ts += 3000 + (int64_t)(rng() % 41) - 20;
+		if (i % 97 == 0)
+		{
+			/* a long gap, as after a sample rate change */
+			ts += 300000;
+		}
+		samples[i].timestamp_ms = ts;
+		samples[i].values[HISTORY_TEMPERATURE] = 21.0f + (float)(rng() % 1000) / 100.0f;
+		samples[i].values[HISTORY_HUMIDITY] = 40.0f + (float)(rng() % 3000) / 100.0f;
+		samples[i].values[HISTORY_PRESSURE] = 100000.0f + (float)(rng() % 500);
+		samples[i].values[HISTORY_CO2] = (i % 10 == 0) ? 400.0f + (float)(rng() % 600) :
+				(i > 0 ? samples[i - 1].values[HISTORY_CO2] : 400.0f);
+		samples[i].values[HISTORY_VOC] = (float)(rng() % 100) / 7.0f;
+		samples[i].values[HISTORY_IAQ] = (i % 10 == 0) ? (float)(rng() % 500) :
+				(i > 0 ? samples[i - 1].values[HISTORY_IAQ] : 50.0f);
+	}
+	/* special values survive the XOR encoding */
+	samples[5].values[HISTORY_VOC] = 0.0f;
+	samples[6].values[HISTORY_VOC] = -0.0f;
+	samples[7].values[HISTORY_TEMPERATURE] = -40.0f;
+}
+
+/* Uniform noise of the given amplitude, in 1/1000 units */
+static float noise(uint32_t amplitude)
+{
+	return (float)((int32_t)(rng() % (2 * amplitude + 1)) - (int32_t)amplitude) / 1000.0f;
+}
+
+/* Readings as BSEC outputs them in the default sample mode: temperature,
+ * humidity and pressure drift slowly with some sensor noise every 3 s, and
+ * the gas outputs are repeated between their refreshes.
+ */
+static void make_benchmark_samples(void)
+{
+	float temperature = 22.5f;
+	float humidity = 41.0f;
+	float pressure = 99131.0f;
+	float co2 = 520.0f;
+	float voc = 0.62f;
+	float iaq = 48.0f;
+	int64_t ts = 1000;
+
+	rng_state = 0x9e3779b9;
+	for (int i = 0; i < BENCHMARK_COUNT; i++)
+	{
+		ts += 3000 + (int64_t)(rng() % 5) - 2;
+		temperature += noise(20);
+		humidity += noise(50);
+		pressure += noise(2000);
+		if (i % GAS_PERIOD == 0)
+		{
+			co2 += noise(20000);
+			voc += noise(50);
+			iaq += noise(3000);
+		}
+		benchmark_samples[i].timestamp_ms = ts;
+		benchmark_samples[i].values[HISTORY_TEMPERATURE] = temperature;
+		benchmark_samples[i].values[HISTORY_HUMIDITY] = humidity;
+		benchmark_samples[i].values[HISTORY_PRESSURE] = pressure;
+		benchmark_samples[i].values[HISTORY_CO2] = co2;
+		benchmark_samples[i].values[HISTORY_VOC] = voc;
+		benchmark_samples[i].values[HISTORY_IAQ] = iaq;
+	}
+}
+
+static void assert_sample_equal(const struct history_sample *read, int index)
+{
+	zassert_equal(read->timestamp_ms, samples[index].timestamp_ms, "sample %d", index);
+	/* bit exact, not only equal as floats */
+	zassert_mem_equal(read->values, samples[index].values, sizeof(read->values),
+			  "sample %d", index);
+}
+
+static void *setup(void)
+{
+	make_samples();
+	return NULL;
+}
+
+static void before(void *fixture)
+{
+	ARG_UNUSED(fixture);
+
+	history_clear();
+}
+
+ZTEST(history, test_empty)
+{
+	struct history_iter iter;
+	struct history_sample sample;
+
+	history_iter_init(&iter, 0);
+	zassert_equal(history_iter_next(&iter, &sample), -ENODATA);
+}
+
+ZTEST(history, test_round_trip)
+{
+	struct history_iter iter;
+	struct history_sample sample;
+	int count = 40;
+
+	for (int i = 0; i < count; i++)
+	{
+		history_append(&samples[i]);
+	}
+
+	history_iter_init(&iter, 0);
+	for (int i = 0; i < count; i++)
+	{
+		zassert_ok(history_iter_next(&iter, &sample));
+		assert_sample_equal(&sample, i);
+	}
+	zassert_equal(history_iter_next(&iter, &sample), -ENODATA);
+	zassert_equal(iter.skipped_blocks, 0);
+
+	/* the reader picks up samples appended after it reached the end */
+	history_append(&samples[count]);
+	zassert_ok(history_iter_next(&iter, &sample));
+	assert_sample_equal(&sample, count);
+}
+
+ZTEST(history, test_wrap_keeps_newest)
+{
+	struct history_iter iter;
+	struct history_sample sample;
+	int first = -1;
+	int index;
+
+	for (int i = 0; i < SAMPLE_COUNT; i++)
+	{
+		history_append(&samples[i]);
+	}
+
+	history_iter_init(&iter, 0);
+	zassert_ok(history_iter_next(&iter, &sample));
+	for (int i = 0; i < SAMPLE_COUNT; i++)
+	{
+		if (samples[i].timestamp_ms == sample.timestamp_ms)
+		{
+			first = i;
+			break;
+		}
+	}
+	zassert_true(first > 0, "oldest samples not dropped");
+
+	/* the remaining samples come in order, up to the newest one */
+	assert_sample_equal(&sample, first);
+	for (index = first + 1; history_iter_next(&iter, &sample) == 0; index++)
+	{
+		assert_sample_equal(&sample, index);
+	}
+	zassert_equal(index, SAMPLE_COUNT);
+}
+
+ZTEST(history, test_overwritten_while_reading)
+{
+	struct history_iter iter;
+	struct history_sample sample;
+	int index = 0;
+
+	for (; index < 200; index++)
+	{
+		history_append(&samples[index]);
+	}
+
+	history_iter_init(&iter, 0);
+	zassert_ok(history_iter_next(&iter, &sample));
+
+	for (; index < SAMPLE_COUNT; index++)
+	{
+		history_append(&samples[index]);
+	}
+
+	/* the reader jumps to the oldest block still stored */
+	zassert_ok(history_iter_next(&iter, &sample));
+	zassert_true(iter.skipped_blocks > 0);
+	while (history_iter_next(&iter, &sample) == 0)
+	{
+	}
+	assert_sample_equal(&sample, SAMPLE_COUNT - 1);
+}
+
+ZTEST(history, test_since)
+{
+	struct history_iter iter;
+	struct history_sample sample;
+	int count = 120;
+	int since = 100;
+
+	for (int i = 0; i < count; i++)
+	{
+		history_append(&samples[i]);
+	}
+
+	history_iter_init(&iter, samples[since].timestamp_ms);
+	zassert_ok(history_iter_next(&iter, &sample));
+	/* reading starts in the block holding the requested time */
+	zassert_true(sample.timestamp_ms <= samples[since].timestamp_ms);
+	zassert_true(history_iter_block(&iter) > 1);
+
+	while (sample.timestamp_ms < samples[since].timestamp_ms)
+	{
+		zassert_ok(history_iter_next(&iter, &sample));
+	}
+	assert_sample_equal(&sample, since);
+}
+
+ZTEST(history, test_clear)
+{
+	struct history_iter iter;
+	struct history_sample sample;
+
+	for (int i = 0; i < 100; i++)
+	{
+		history_append(&samples[i]);
+	}
+	history_iter_init(&iter, 0);
+	zassert_ok(history_iter_next(&iter, &sample));
+
+	history_clear();
+	zassert_equal(history_iter_next(&iter, &sample), -ENODATA);
+
+	history_append(&samples[100]);
+	zassert_ok(history_iter_next(&iter, &sample));
+	assert_sample_equal(&sample, 100);
+	zassert_true(iter.skipped_blocks > 0);
+}
+
+/* Space and time taken by realistic samples. The bytes per sample include
+ * the raw first sample and the unused end of each block. native_sim does
+ * not count the cycles spent computing, run the suite on a board for them.
+ */
+ZTEST(history, test_benchmark)
+{
+	struct history_usage usage;
+	uint32_t cycles = 0;
+
+	make_benchmark_samples();
+	for (int i = 0; i < BENCHMARK_COUNT; i++)
+	{
+		uint32_t start = k_cycle_get_32();
+
+		history_append(&benchmark_samples[i]);
+		cycles += k_cycle_get_32() - start;
+	}
+
+	history_get_usage(&usage);
+	zassert_true(usage.samples > 0);
+	TC_PRINT("%u samples in %u blocks: %u bits, %u bits per sample, %u bytes of history "
+			 "per sample, %u cycles per append\n",
+			 usage.samples, usage.blocks, usage.bits, usage.bits / usage.samples,
+			 usage.blocks * CONFIG_APP_HISTORY_BLOCK_SIZE / usage.samples,
+			 cycles / BENCHMARK_COUNT);
+
+	/* well below the 28 bytes of a raw sample */
+	zassert_true(usage.bits / usage.samples < 28 * 8);
+}
+
+ZTEST_SUITE(history, NULL, setup, before, NULL, NULL);
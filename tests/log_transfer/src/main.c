@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) 2025 Grovety Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/storage/flash_map.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/ztest.h>
+
+#include "log_packet.h"
+#include "log_transfer.h"
+#include "telemetry_log.h"
+
+LOG_MODULE_REGISTER(app, CONFIG_APP_LOG_LEVEL);
+
+#define RECORD_SIZE sizeof(struct telemetry_record)
+#define SECTOR_SLOTS (CONFIG_APP_TELEMETRY_LOG_SECTOR_SIZE / RECORD_SIZE - 1)
+/* Records per notification at the default ATT MTU of 247 */
+#define PACKET_RECORDS 7
+/* Spans the first sector boundary */
+#define LOG_RECORDS (2 * SECTOR_SLOTS + 20)
+/* Records appended within each second */
+#define RECORDS_PER_SEC 10
+
+/* A transfer as log_transfer.c runs it, without the notifications */
+struct transfer
+{
+	struct telemetry_log_iter iter;
+	uint32_t skip;
+	uint32_t offset;
+	bool end_of_log;
+	uint8_t packet[LOG_TRANSFER_HEADER_LEN + PACKET_RECORDS * RECORD_SIZE];
+};
+
+static const struct flash_area *fa;
+static struct transfer transfer;
+/* Timestamp of the first record */
+static uint32_t first_ts;
+
+static void transfer_start(uint32_t since, uint32_t offset)
+{
+	memset(&transfer, 0, sizeof(transfer));
+	zassert_ok(telemetry_log_iter_init(&transfer.iter, since));
+	transfer.skip = offset;
+	transfer.offset = offset;
+}
+
+/* Builds the next packet and checks its header and records, which follow
+ * expected_seq. Returns the number of records.
+ */
+static int next_packet(uint32_t expected_seq)
+{
+	struct telemetry_record record;
+	int count = log_packet_fill(&transfer.iter, &transfer.skip, transfer.offset, transfer.packet,
+								PACKET_RECORDS, &transfer.end_of_log);
+
+	zassert_true(count >= 0, "fill failed (err %d)", count);
+	if (count > 0)
+	{
+		zassert_equal(sys_get_le32(transfer.packet), transfer.offset);
+	}
+	for (int i = 0; i < count; i++)
+	{
+		memcpy(&record, &transfer.packet[LOG_TRANSFER_HEADER_LEN + i * RECORD_SIZE],
+			   RECORD_SIZE);
+		zassert_equal(record.seq, expected_seq + i, "record %u instead of %u", record.seq,
+					  expected_seq + i);
+		zassert_equal(record.co2, (uint16_t)record.seq);
+	}
+	transfer.offset += count;
+	return count;
+}
+
+/* Runs the transfer to the end, and returns the number of records sent */
+static uint32_t run_to_end(uint32_t first_seq)
+{
+	uint32_t records = 0;
+
+	while (!transfer.end_of_log)
+	{
+		records += next_packet(first_seq + records);
+	}
+	return records;
+}
+
+static void *setup(void)
+{
+	struct telemetry_log_iter iter;
+	struct telemetry_record record;
+
+	zassert_ok(flash_area_open(FIXED_PARTITION_ID(telemetry_partition), &fa));
+	zassert_ok(flash_area_erase(fa, 0, fa->fa_size));
+	zassert_ok(telemetry_log_init());
+
+	/* log time advances with the uptime, start on a whole second */
+	k_sleep(K_MSEC(MSEC_PER_SEC - k_uptime_get() % MSEC_PER_SEC));
+	for (uint32_t seq = 0; seq < LOG_RECORDS; seq++)
+	{
+		memset(&record, 0, sizeof(record));
+		record.co2 = (uint16_t)seq;
+		zassert_ok(telemetry_log_append(&record));
+		if (seq % RECORDS_PER_SEC == RECORDS_PER_SEC - 1)
+		{
+			k_sleep(K_SECONDS(1));
+		}
+	}
+	zassert_ok(telemetry_log_flush());
+
+	zassert_ok(telemetry_log_iter_init(&iter, 0));
+	zassert_ok(telemetry_log_iter_next(&iter, &record));
+	first_ts = record.timestamp;
+	return NULL;
+}
+
+ZTEST(log_transfer, test_whole_log)
+{
+	transfer_start(0, 0);
+	zassert_equal(run_to_end(0), LOG_RECORDS);
+
+	/* a packet built after the end holds nothing */
+	zassert_equal(next_packet(LOG_RECORDS), 0);
+}
+
+ZTEST(log_transfer, test_offset)
+{
+	/* the skipped records span the first sector boundary */
+	uint32_t offset = SECTOR_SLOTS + 3;
+
+	transfer_start(0, offset);
+	zassert_equal(next_packet(offset), PACKET_RECORDS);
+	zassert_equal(transfer.skip, 0);
+	zassert_equal(run_to_end(offset + PACKET_RECORDS), LOG_RECORDS - offset - PACKET_RECORDS);
+}
+
+/* A transfer cut short resumes with the offset of the first record not
+ * received, and carries on as if it had not been interrupted.
+ */
+ZTEST(log_transfer, test_resume)
+{
+	uint32_t received = 0;
+
+	transfer_start(0, 0);
+	while (received < SECTOR_SLOTS)
+	{
+		received += next_packet(received);
+	}
+
+	transfer_start(0, received);
+	zassert_equal(run_to_end(received), LOG_RECORDS - received);
+}
+
+/* The offset counts from the first record at or after the requested time */
+ZTEST(log_transfer, test_offset_since)
+{
+	uint32_t second = SECTOR_SLOTS / RECORDS_PER_SEC;
+	uint32_t offset = 5;
+	uint32_t first_seq = second * RECORDS_PER_SEC + offset;
+
+	transfer_start(first_ts + second, offset);
+	zassert_equal(run_to_end(first_seq), LOG_RECORDS - first_seq);
+}
+
+ZTEST(log_transfer, test_offset_past_end)
+{
+	transfer_start(0, LOG_RECORDS + 5);
+	zassert_equal(next_packet(0), 0);
+	zassert_true(transfer.end_of_log);
+	zassert_equal(transfer.skip, 5);
+}
+
+ZTEST_SUITE(log_transfer, NULL, setup, NULL, NULL, NULL);
@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2025 Grovety Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/ztest.h>
+
+#include "sampling_policy.h"
+
+#define LOW_PPTT 2000
+#define CRITICAL_PPTT 500
+#define HYSTERESIS_PPTT 300
+#define FULL_PPTT 10000
+#define HOLD_MS 60000
+
+static const struct sampling_policy_config config = {
+	.low_battery_pptt = LOW_PPTT,
+	.critical_battery_pptt = CRITICAL_PPTT,
+	.battery_hysteresis_pptt = HYSTERESIS_PPTT,
+	.co2_rise_per_min = 100.0f,
+	.iaq_rise_per_min = 50.0f,
+	.fast_hold_ms = HOLD_MS,
+};
+
+static struct sampling_policy policy;
+
+static enum sampling_level update(int64_t timestamp_ms, unsigned int battery_pptt, float co2,
+				  float iaq)
+{
+	const struct sampling_input input = {
+		.timestamp_ms = timestamp_ms,
+		.battery_pptt = battery_pptt,
+		.has_battery = true,
+		.co2 = co2,
+		.iaq = iaq,
+	};
+
+	return sampling_policy_update(&policy, &input);
+}
+
+static void before(void *fixture)
+{
+	ARG_UNUSED(fixture);
+
+	sampling_policy_init(&policy, &config);
+}
+
+ZTEST(sampling_policy, test_normal)
+{
+	zassert_equal(update(0, FULL_PPTT, 400.0f, 50.0f), SAMPLING_LEVEL_NORMAL);
+	zassert_equal(update(60000, FULL_PPTT, 450.0f, 60.0f), SAMPLING_LEVEL_NORMAL);
+}
+
+ZTEST(sampling_policy, test_low_battery_hysteresis)
+{
+	zassert_equal(update(0, LOW_PPTT, 400.0f, 50.0f), SAMPLING_LEVEL_NORMAL);
+	zassert_equal(update(1000, LOW_PPTT - 1, 400.0f, 50.0f), SAMPLING_LEVEL_SAVING);
+	/* back at the threshold is not enough to leave the saving level */
+	zassert_equal(update(2000, LOW_PPTT, 400.0f, 50.0f), SAMPLING_LEVEL_SAVING);
+	zassert_equal(update(3000, LOW_PPTT + HYSTERESIS_PPTT - 1, 400.0f, 50.0f),
+		      SAMPLING_LEVEL_SAVING);
+	zassert_equal(update(4000, LOW_PPTT + HYSTERESIS_PPTT, 400.0f, 50.0f),
+		      SAMPLING_LEVEL_NORMAL);
+}
+
+ZTEST(sampling_policy, test_critical_battery_hysteresis)
+{
+	zassert_equal(update(0, CRITICAL_PPTT - 1, 400.0f, 50.0f), SAMPLING_LEVEL_CRITICAL);
+	zassert_equal(update(1000, CRITICAL_PPTT + HYSTERESIS_PPTT - 1, 400.0f, 50.0f),
+		      SAMPLING_LEVEL_CRITICAL);
+	/* leaving the critical level goes through the saving level */
+	zassert_equal(update(2000, CRITICAL_PPTT + HYSTERESIS_PPTT, 400.0f, 50.0f),
+		      SAMPLING_LEVEL_SAVING);
+	zassert_equal(update(3000, CRITICAL_PPTT - 1, 400.0f, 50.0f), SAMPLING_LEVEL_CRITICAL);
+}
+
+ZTEST(sampling_policy, test_fast_on_co2_rise)
+{
+	zassert_equal(update(0, FULL_PPTT, 400.0f, 50.0f), SAMPLING_LEVEL_NORMAL);
+	/* 100 ppm in 30 s is 200 ppm per minute */
+	zassert_equal(update(30000, FULL_PPTT, 500.0f, 50.0f), SAMPLING_LEVEL_FAST);
+	/* kept for the hold time after the rise, even with stable readings */
+	zassert_equal(update(30000 + HOLD_MS - 1, FULL_PPTT, 500.0f, 50.0f),
+		      SAMPLING_LEVEL_FAST);
+	zassert_equal(update(30000 + HOLD_MS, FULL_PPTT, 500.0f, 50.0f), SAMPLING_LEVEL_NORMAL);
+}
+
+ZTEST(sampling_policy, test_fast_on_iaq_rise)
+{
+	zassert_equal(update(0, FULL_PPTT, 400.0f, 50.0f), SAMPLING_LEVEL_NORMAL);
+	zassert_equal(update(60000, FULL_PPTT, 400.0f, 100.0f), SAMPLING_LEVEL_FAST);
+}
+
+ZTEST(sampling_policy, test_slow_rise)
+{
+	zassert_equal(update(0, FULL_PPTT, 400.0f, 50.0f), SAMPLING_LEVEL_NORMAL);
+	zassert_equal(update(60000, FULL_PPTT, 499.0f, 99.0f), SAMPLING_LEVEL_NORMAL);
+	/* falling readings never select the fast level */
+	zassert_equal(update(61000, FULL_PPTT, 300.0f, 10.0f), SAMPLING_LEVEL_NORMAL);
+}
+
+ZTEST(sampling_policy, test_rate_between_changed_readings)
+{
+	zassert_equal(update(0, FULL_PPTT, 400.0f, 50.0f), SAMPLING_LEVEL_NORMAL);
+	/* the gas outputs are not refreshed by every update */
+	zassert_equal(update(240000, FULL_PPTT, 400.0f, 50.0f), SAMPLING_LEVEL_NORMAL);
+	/* 150 ppm over the 5 minutes since the last change is slow */
+	zassert_equal(update(300000, FULL_PPTT, 550.0f, 50.0f), SAMPLING_LEVEL_NORMAL);
+}
+
+ZTEST(sampling_policy, test_critical_overrides_fast)
+{
+	zassert_equal(update(0, FULL_PPTT, 400.0f, 50.0f), SAMPLING_LEVEL_NORMAL);
+	zassert_equal(update(30000, FULL_PPTT, 600.0f, 50.0f), SAMPLING_LEVEL_FAST);
+	zassert_equal(update(31000, CRITICAL_PPTT - 1, 600.0f, 50.0f), SAMPLING_LEVEL_CRITICAL);
+	zassert_equal(update(60000, CRITICAL_PPTT - 1, 800.0f, 50.0f), SAMPLING_LEVEL_CRITICAL);
+}
+
+ZTEST(sampling_policy, test_fast_over_saving)
+{
+	zassert_equal(update(0, LOW_PPTT - 1, 400.0f, 50.0f), SAMPLING_LEVEL_SAVING);
+	zassert_equal(update(30000, LOW_PPTT - 1, 600.0f, 50.0f), SAMPLING_LEVEL_FAST);
+}
+
+ZTEST(sampling_policy, test_battery_unknown)
+{
+	const struct sampling_input input = {
+		.timestamp_ms = 0,
+		.battery_pptt = 0,
+		.has_battery = false,
+		.co2 = 400.0f,
+		.iaq = 50.0f,
+	};
+
+	/* no battery sample yet, the level stays normal */
+	zassert_equal(sampling_policy_update(&policy, &input), SAMPLING_LEVEL_NORMAL);
+	zassert_equal(update(1000, CRITICAL_PPTT - 1, 400.0f, 50.0f), SAMPLING_LEVEL_CRITICAL);
+}
+
+ZTEST_SUITE(sampling_policy, NULL, NULL, before, NULL, NULL);
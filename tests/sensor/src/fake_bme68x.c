@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2025 Grovety Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/* BME68x IAQ driver replaced by samples published by the test */
+
+#define DT_DRV_COMPAT bosch_bme680
+
+#include <errno.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/sensor.h>
+
+#include "fake_bme68x.h"
+
+static sensor_trigger_handler_t handler;
+static const struct sensor_trigger *trigger;
+static struct bme_sample_result latest;
+static bool published;
+
+static int fake_trigger_set(const struct device *dev, const struct sensor_trigger *trig,
+							sensor_trigger_handler_t trig_handler)
+{
+	ARG_UNUSED(dev);
+
+	if (trig->type != SENSOR_TRIG_DATA_READY)
+	{
+		return -ENOTSUP;
+	}
+	trigger = trig;
+	handler = trig_handler;
+	return 0;
+}
+
+static int fake_attr_set(const struct device *dev, enum sensor_channel chan,
+						 enum sensor_attribute attr, const struct sensor_value *val)
+{
+	ARG_UNUSED(dev);
+	ARG_UNUSED(chan);
+	ARG_UNUSED(attr);
+	ARG_UNUSED(val);
+
+	return 0;
+}
+
+static int fake_sample_fetch(const struct device *dev, enum sensor_channel chan)
+{
+	ARG_UNUSED(dev);
+	ARG_UNUSED(chan);
+
+	return 0;
+}
+
+static int fake_channel_get(const struct device *dev, enum sensor_channel chan,
+							struct sensor_value *val)
+{
+	ARG_UNUSED(dev);
+	ARG_UNUSED(chan);
+	ARG_UNUSED(val);
+
+	return -ENOTSUP;
+}
+
+static const struct sensor_driver_api fake_api = {
+	.attr_set = fake_attr_set,
+	.trigger_set = fake_trigger_set,
+	.sample_fetch = fake_sample_fetch,
+	.channel_get = fake_channel_get,
+};
+
+DEVICE_DT_INST_DEFINE(0, NULL, NULL, NULL, NULL, POST_KERNEL, CONFIG_SENSOR_INIT_PRIORITY,
+					  &fake_api);
+
+int bme68x_iaq_get_snapshot(const struct device *dev, struct bme_sample_result *out)
+{
+	ARG_UNUSED(dev);
+
+	if (!published)
+	{
+		return -ENODATA;
+	}
+	*out = latest;
+	return 0;
+}
+
+int bme68x_iaq_save_state(const struct device *dev)
+{
+	ARG_UNUSED(dev);
+
+	return 0;
+}
+
+void fake_bme68x_publish(const struct bme_sample_result *sample)
+{
+	latest = *sample;
+	published = true;
+	if (handler)
+	{
+		handler(DEVICE_DT_INST_GET(0), trigger);
+	}
+}
+
+bool fake_bme68x_has_trigger(void)
+{
+	return handler != NULL;
+}
+
+void fake_bme68x_reset(void)
+{
+	published = false;
+	handler = NULL;
+	trigger = NULL;
+}
@@ -0,0 +1,35 @@
+/*
+ * Copyright (c) 2025 Grovety Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <drivers/bme68x_iaq_ext.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    /**
+     * @brief Publishes a sample as the BSEC work does, calling the data
+     *  ready handler if one is set.
+     */
+    void fake_bme68x_publish(const struct bme_sample_result *sample);
+
+    /**
+     * @brief Checks if a data ready handler is set.
+     */
+    bool fake_bme68x_has_trigger(void);
+
+    /**
+     * @brief Forgets the published sample and the trigger.
+     */
+    void fake_bme68x_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2025 Grovety Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/ztest.h>
+
+#include "battery.h"
+#include "fake_bme68x.h"
+#include "sensor.hxx"
+
+LOG_MODULE_REGISTER(app, CONFIG_APP_LOG_LEVEL);
+
+#define PUBLISH_DELAY_MS 50
+
+static CSensor sensor;
+
+static const struct bme_sample_result sample_a = {
+    .temperature = 21.5f,
+    .humidity = 45.0f,
+    .pressure = 101325.0f,
+    .air_quality = 80,
+    .co2 = 650.0f,
+    .voc = 0.8f,
+    .timestamp_ms = 3000,
+};
+
+static const struct bme_sample_result sample_b = {
+    .temperature = 22.0f,
+    .humidity = 47.0f,
+    .pressure = 101300.0f,
+    .air_quality = 95,
+    .co2 = 700.0f,
+    .voc = 1.1f,
+    .timestamp_ms = 6000,
+};
+
+/* The battery service is not part of this test, the level is set by the
+ * tests and is unknown until then
+ */
+static int battery_pptt;
+
+int battery_service_start(void)
+{
+    return 0;
+}
+
+int battery_get_pptt(void)
+{
+    return battery_pptt;
+}
+
+static void publish_timer_handler(struct k_timer *timer)
+{
+    ARG_UNUSED(timer);
+
+    fake_bme68x_publish(&sample_a);
+}
+
+static K_TIMER_DEFINE(publish_timer, publish_timer_handler, NULL);
+
+static void before(void *fixture)
+{
+    ARG_UNUSED(fixture);
+
+    fake_bme68x_reset();
+    battery_pptt = -ENODATA;
+    zassert_ok(sensor.init());
+    /* drop a wakeup left by the previous test */
+    (void)sensor.wait_for_data(K_NO_WAIT);
+}
+
+ZTEST(sensor, test_init_sets_trigger)
+{
+    zassert_true(fake_bme68x_has_trigger());
+}
+
+ZTEST(sensor, test_no_data_yet)
+{
+    zassert_equal(sensor.wait_for_data(K_MSEC(10)), -EAGAIN);
+    zassert_equal(sensor.update_measurements(), -ENODATA);
+}
+
+ZTEST(sensor, test_wakes_on_data)
+{
+    fake_bme68x_publish(&sample_a);
+
+    zassert_ok(sensor.wait_for_data(K_NO_WAIT));
+    zassert_ok(sensor.update_measurements());
+    zassert_equal(sensor.get_temperature(), sample_a.temperature);
+    zassert_equal(sensor.get_co2(), sample_a.co2);
+    zassert_equal(sensor.get_iaq(), sample_a.air_quality);
+    zassert_equal(sensor.get_timestamp_ms(), sample_a.timestamp_ms);
+
+    /* one wakeup per output */
+    zassert_equal(sensor.wait_for_data(K_NO_WAIT), -EAGAIN);
+}
+
+ZTEST(sensor, test_outputs_coalesce)
+{
+    /* outputs published while the main loop is busy wake it once, and it
+     * reads the latest one
+     */
+    fake_bme68x_publish(&sample_a);
+    fake_bme68x_publish(&sample_b);
+
+    zassert_ok(sensor.wait_for_data(K_NO_WAIT));
+    zassert_ok(sensor.update_measurements());
+    zassert_equal(sensor.get_timestamp_ms(), sample_b.timestamp_ms);
+    zassert_equal(sensor.wait_for_data(K_NO_WAIT), -EAGAIN);
+}
+
+ZTEST(sensor, test_sleeps_until_data)
+{
+    int64_t start = k_uptime_get();
+
+    k_timer_start(&publish_timer, K_MSEC(PUBLISH_DELAY_MS), K_NO_WAIT);
+
+    /* the wait ends with the output, long before the timeout */
+    zassert_ok(sensor.wait_for_data(K_SECONDS(10)));
+    zassert_true(k_uptime_get() - start >= PUBLISH_DELAY_MS);
+    zassert_true(k_uptime_get() - start < 1000);
+}
+
+ZTEST(sensor, test_battery_percent)
+{
+    float percent = 50.0f;
+
+    /* no level before the battery was sampled, not 0 % */
+    zassert_equal(sensor.get_battery_percent(&percent), -ENODATA);
+    zassert_equal(percent, 50.0f);
+
+    battery_pptt = 9990;
+    zassert_ok(sensor.get_battery_percent(&percent));
+    zassert_within(percent, 99.9f, 0.001f);
+}
+
+ZTEST_SUITE(sensor, NULL, NULL, before, NULL, NULL);
@@ -0,0 +1,280 @@
+/*
+ * Copyright (c) 2025 Grovety Inc
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/storage/flash_map.h>
+#include <zephyr/ztest.h>
+
+#include "telemetry_log.h"
+
+LOG_MODULE_REGISTER(app, CONFIG_APP_LOG_LEVEL);
+
+/* Flash layout of the log: each sector starts with a header taking one
+ * record slot.
+ */
+#define SECTOR_SIZE CONFIG_APP_TELEMETRY_LOG_SECTOR_SIZE
+#define RECORD_SIZE sizeof(struct telemetry_record)
+#define SECTOR_SLOTS (SECTOR_SIZE / RECORD_SIZE - 1)
+#define SECTOR_COUNT (FIXED_PARTITION_SIZE(telemetry_partition) / SECTOR_SIZE)
+#define BATCH_SIZE CONFIG_APP_TELEMETRY_LOG_BATCH
+
+/* Records appended within each second by test_seek_by_timestamp. A sector
+ * does not hold a whole number of seconds, so records of the same second
+ * straddle each sector boundary.
+ */
+#define RECORDS_PER_SEC 10
+BUILD_ASSERT(SECTOR_SLOTS % RECORDS_PER_SEC != 0);
+
+static const struct flash_area *fa;
+
+static off_t slot_offset(uint16_t sector, uint16_t slot)
+{
+	return (off_t)sector * SECTOR_SIZE + (slot + 1) * RECORD_SIZE;
+}
+
+static void append(uint32_t count, uint32_t first_value)
+{
+	for (uint32_t i = 0; i < count; i++)
+	{
+		struct telemetry_record record = {
+			.temperature = 2100,
+			.humidity = 4500,
+			.pressure = 101325,
+			.co2 = (uint16_t)(first_value + i),
+		};
+
+		zassert_ok(telemetry_log_append(&record));
+	}
+}
+
+/* Reads the whole log, checking that the records follow each other, except
+ * for missing_seq. Returns the number of records read.
+ */
+static uint32_t read_all_skipping(uint32_t *first_seq, uint32_t *last_seq, uint32_t missing_seq)
+{
+	struct telemetry_log_iter iter;
+	struct telemetry_record record;
+	uint32_t count = 0;
+	int err;
+
+	zassert_ok(telemetry_log_iter_init(&iter, 0));
+	while ((err = telemetry_log_iter_next(&iter, &record)) == 0)
+	{
+		if (count == 0)
+		{
+			*first_seq = record.seq;
+		}
+		else
+		{
+			uint32_t expected = *last_seq + 1 == missing_seq ? *last_seq + 2 : *last_seq + 1;
+
+			zassert_equal(record.seq, expected, "record %u follows %u", record.seq,
+						  *last_seq);
+		}
+		/* the tests append the sequence number as the value */
+		zassert_equal(record.co2, (uint16_t)record.seq);
+		zassert_equal(record.pressure, 101325);
+		*last_seq = record.seq;
+		count++;
+	}
+	zassert_equal(err, -ENODATA);
+	return count;
+}
+
+static uint32_t read_all(uint32_t *first_seq, uint32_t *last_seq)
+{
+	return read_all_skipping(first_seq, last_seq, UINT32_MAX);
+}
+
+static void *setup(void)
+{
+	zassert_ok(flash_area_open(FIXED_PARTITION_ID(telemetry_partition), &fa));
+	return NULL;
+}
+
+static void before(void *fixture)
+{
+	ARG_UNUSED(fixture);
+
+	zassert_ok(flash_area_erase(fa, 0, fa->fa_size));
+}
+
+ZTEST(telemetry_log, test_new_log)
+{
+	static const uint8_t garbage[64] = {0x5a};
+	uint32_t first, last;
+
+	/* a partition holding something else is taken over */
+	zassert_ok(flash_area_write(fa, 0, garbage, sizeof(garbage)));
+	zassert_ok(telemetry_log_init());
+
+	append(20, 0);
+	zassert_ok(telemetry_log_flush());
+
+	zassert_equal(read_all(&first, &last), 20);
+	zassert_equal(first, 0);
+	zassert_equal(last, 19);
+}
+
+ZTEST(telemetry_log, test_torn_record)
+{
+	struct telemetry_record record;
+	uint32_t first, last;
+
+	zassert_ok(telemetry_log_init());
+	append(BATCH_SIZE, 0);
+
+	/* power lost in the middle of the next batch: the first record is
+	 * half written
+	 */
+	zassert_ok(flash_area_read(fa, slot_offset(0, BATCH_SIZE - 1), &record, RECORD_SIZE));
+	record.seq++;
+	zassert_ok(flash_area_write(fa, slot_offset(0, BATCH_SIZE), &record, RECORD_SIZE / 2));
+
+	zassert_ok(telemetry_log_init());
+	zassert_equal(read_all(&first, &last), BATCH_SIZE);
+	zassert_equal(last, BATCH_SIZE - 1);
+
+	/* the log carries on after the torn slot, with the next sequence
+	 * number; the simulated flash rejects writes to the torn slot
+	 */
+	append(BATCH_SIZE, BATCH_SIZE);
+	zassert_equal(read_all(&first, &last), 2 * BATCH_SIZE);
+	zassert_equal(first, 0);
+	zassert_equal(last, 2 * BATCH_SIZE - 1);
+}
+
+ZTEST(telemetry_log, test_corrupted_record)
+{
+	static uint8_t sector[SECTOR_SIZE];
+	uint32_t first, last;
+
+	zassert_ok(telemetry_log_init());
+	append(BATCH_SIZE, 0);
+
+	/* flip a bit of the fourth record */
+	zassert_ok(flash_area_read(fa, 0, sector, sizeof(sector)));
+	sector[slot_offset(0, 3) + offsetof(struct telemetry_record, co2)] ^= 0x01;
+	zassert_ok(flash_area_erase(fa, 0, SECTOR_SIZE));
+	zassert_ok(flash_area_write(fa, 0, sector, sizeof(sector)));
+
+	/* the record is skipped, the others are read */
+	zassert_ok(telemetry_log_init());
+	zassert_equal(read_all_skipping(&first, &last, 3), BATCH_SIZE - 1);
+	zassert_equal(last, BATCH_SIZE - 1);
+}
+
+ZTEST(telemetry_log, test_torn_sector_header)
+{
+	static const uint8_t torn_header[10] = {0x47, 0x4f, 0x4c, 0x54, 0x02};
+	uint32_t first, last;
+
+	zassert_ok(telemetry_log_init());
+	append(SECTOR_SLOTS, 0);
+	zassert_ok(telemetry_log_flush());
+
+	/* power lost while the next sector was being opened */
+	zassert_ok(flash_area_erase(fa, SECTOR_SIZE, SECTOR_SIZE));
+	zassert_ok(flash_area_write(fa, SECTOR_SIZE, torn_header, sizeof(torn_header)));
+
+	zassert_ok(telemetry_log_init());
+	zassert_equal(read_all(&first, &last), SECTOR_SLOTS);
+
+	/* the sector is erased again when the log moves on to it */
+	append(BATCH_SIZE, SECTOR_SLOTS);
+	zassert_equal(read_all(&first, &last), SECTOR_SLOTS + BATCH_SIZE);
+	zassert_equal(last, SECTOR_SLOTS + BATCH_SIZE - 1);
+}
+
+ZTEST(telemetry_log, test_wrap)
+{
+	uint32_t total = SECTOR_COUNT * SECTOR_SLOTS + 100;
+	uint32_t first, last;
+	uint32_t count;
+
+	zassert_ok(telemetry_log_init());
+	append(total, 0);
+	zassert_ok(telemetry_log_flush());
+
+	/* after a reboot, the oldest sector has been erased for the newest
+	 * records, and appending carries on from the newest one
+	 */
+	zassert_ok(telemetry_log_init());
+	count = read_all(&first, &last);
+	zassert_true(first > 0);
+	zassert_equal(last, total - 1);
+	zassert_true(count > (SECTOR_COUNT - 1) * SECTOR_SLOTS);
+
+	append(BATCH_SIZE, total);
+	zassert_ok(telemetry_log_flush());
+	read_all(&first, &last);
+	zassert_equal(last, total + BATCH_SIZE - 1);
+}
+
+/* Seeks to the records logged second seconds after the first one, and
+ * checks that the first record read is the first record of that second.
+ */
+static void assert_seek(uint32_t first_ts, uint32_t second)
+{
+	struct telemetry_log_iter iter;
+	struct telemetry_record record;
+
+	zassert_ok(telemetry_log_iter_init(&iter, first_ts + second));
+	zassert_ok(telemetry_log_iter_next(&iter, &record));
+	zassert_equal(record.seq, second * RECORDS_PER_SEC, "seek to second %u read record %u",
+				  second, record.seq);
+	zassert_equal(record.timestamp, first_ts + second);
+}
+
+ZTEST(telemetry_log, test_seek_by_timestamp)
+{
+	const uint32_t total = 3 * SECTOR_SLOTS;
+	/* the second whose records straddle the end of the first sector */
+	const uint32_t straddling = SECTOR_SLOTS / RECORDS_PER_SEC;
+	struct telemetry_log_iter iter;
+	struct telemetry_record record;
+	uint32_t first_ts;
+
+	zassert_ok(telemetry_log_init());
+
+	/* log time advances with the uptime, start on a whole second */
+	k_sleep(K_MSEC(MSEC_PER_SEC - k_uptime_get() % MSEC_PER_SEC));
+	for (uint32_t i = 0; i < total; i += RECORDS_PER_SEC)
+	{
+		append(MIN(RECORDS_PER_SEC, total - i), i);
+		k_sleep(K_SECONDS(1));
+	}
+	zassert_ok(telemetry_log_flush());
+
+	zassert_ok(telemetry_log_iter_init(&iter, 0));
+	zassert_ok(telemetry_log_iter_next(&iter, &record));
+	zassert_equal(record.seq, 0);
+	first_ts = record.timestamp;
+
+	assert_seek(first_ts, 0);
+	/* the seek starts in the first sector, which holds the first
+	 * records of that second, not in the second sector starting with it
+	 */
+	assert_seek(first_ts, straddling);
+	assert_seek(first_ts, straddling + 1);
+	/* mid log, in the second sector */
+	assert_seek(first_ts, 2 * straddling - 4);
+	/* in the last sector */
+	assert_seek(first_ts, total / RECORDS_PER_SEC - 1);
+
+	/* nothing was logged after the last second */
+	zassert_ok(telemetry_log_iter_init(&iter, first_ts + DIV_ROUND_UP(total, RECORDS_PER_SEC)));
+	zassert_equal(telemetry_log_iter_next(&iter, &record), -ENODATA);
+
+	/* the index rebuilt at boot seeks the same way */
+	zassert_ok(telemetry_log_init());
+	assert_seek(first_ts, straddling);
+	assert_seek(first_ts, 2 * straddling - 4);
+}
+
+ZTEST_SUITE(telemetry_log, NULL, setup, before, NULL, NULL);